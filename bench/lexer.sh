@@ -0,0 +1,26 @@
+#!/bin/sh
+# Lexer throughput: generates a program of several megabytes and reports how many tokens per second t reads.
+# Usage: bench/lexer.sh [t executable] [functions]
+T=$(realpath "${1:-./cmake-build-debug/t}")
+N=${2:-25000}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+awk -v n="$N" 'BEGIN {
+    for (i = 0; i < n; i++) {
+        print "# step" i " mixes identifiers, numbers, operators and keywords"
+        print "def step" i "(number x, number y) -> number"
+        print "    var number a = (x + " i ".5) * y - x / 7"
+        print "    if a > 100 do"
+        print "        a = a - 42"
+        print "    else"
+        print "        a = a + 1"
+        print "    end"
+        print "    return a"
+        print "end"
+    }
+    print "return 0"
+}' > "$DIR/lexer.t"
+
+echo "$(wc -c < "$DIR/lexer.t") bytes"
+cd "$DIR" && "$T" lexer.t --time-phases --no-cache 2>&1 | grep '^parse:'
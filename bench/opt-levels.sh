@@ -0,0 +1,41 @@
+#!/bin/sh
+# Compile time and run time at each optimization level: compiles a numeric program that calls the std/math.t helpers
+# in hot loops to an object file, links it against the runtime and runs it.
+# Usage: bench/opt-levels.sh [t executable]
+REPO=$(cd "$(dirname "$0")/.." && pwd)
+T=$(realpath "${1:-./cmake-build-debug/t}")
+COREFN=$(dirname "$T")/corefn
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+cat > opt.t <<PROGRAM
+import "$REPO/std/io.t"
+import "$REPO/std/math.t"
+var number[1024] values
+var number total = 0
+for round = 0, round < 20000, 1 do
+    for i = 0, i < 1024, 1 do
+        values[i] = max(sqrt(i * 1.5 + round), factorial(5)) * 0.5
+    end
+    for i = 0, i < 1024, 1 do
+        total = total + values[i] / 1024
+    end
+end
+printNumber(total)
+printAscii(10)
+return 0
+PROGRAM
+
+now() { date +%s.%N; }
+for LEVEL in 0 1 2 3 s; do
+    START=$(now)
+    "$T" opt.t -O$LEVEL --no-cache || exit 1
+    COMPILED=$(now)
+    ${CXX:-c++} -no-pie output.o -L"$COREFN" -lt_corefn -o opt || exit 1
+    RUN_START=$(now)
+    LD_LIBRARY_PATH="$COREFN" ./opt > /dev/null
+    END=$(now)
+    echo "$START $COMPILED $RUN_START $END" |
+            awk -v level="$LEVEL" '{ printf "-O%s: compile %.0f ms, run %.0f ms\n", level, ($2 - $1) * 1000, ($4 - $3) * 1000 }'
+done
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Parse time and memory: generates a large program and reports the parse phase, the memory its AST takes and the peak
+# memory of the whole compilation.
+# Usage: bench/parse.sh [t executable] [functions]
+T=$(realpath "${1:-./cmake-build-debug/t}")
+N=${2:-20000}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+awk -v n="$N" 'BEGIN {
+    for (i = 0; i < n; i++) {
+        print "def sum" i "(number x) -> number"
+        print "    var number[8] values"
+        print "    var number s = 0"
+        print "    for j = 0, j < 8, 1 do"
+        print "        values[j] = x * j + " i
+        print "        s = s + values[j]"
+        print "    end"
+        print "    while s > 1000 do"
+        print "        s = s / 2"
+        print "    end"
+        print "    return s"
+        print "end"
+    }
+    print "return 0"
+}' > "$DIR/parse.t"
+
+echo "$(wc -c < "$DIR/parse.t") bytes"
+cd "$DIR" || exit 1
+if [ -x /usr/bin/time ]; then
+    /usr/bin/time -f "peak memory: %M KB" "$T" parse.t --time-phases --no-cache 2>&1 | grep '^parse:\|^peak'
+else
+    "$T" parse.t --time-phases --no-cache 2>&1 | grep '^parse:'
+fi
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Symbol lookups in deep scopes: generates functions whose ifs are nested 10, 100 and 1000 levels deep, with the same
+# number of locals and lookups in total, and reports how long type checking and codegen take. With lookups that don't
+# depend on the depth the times stay about the same.
+# Usage: bench/scopes.sh [t executable] [locals]
+T=$(realpath "${1:-./cmake-build-debug/t}")
+LOCALS=${2:-20000}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+for DEPTH in 10 100 1000; do
+    awk -v depth="$DEPTH" -v locals="$LOCALS" 'BEGIN {
+        perLevel = int(locals / depth)
+        print "def deep(number x) -> number"
+        print "    var number outer = x"
+        for (d = 0; d < depth; d++) {
+            print "if x > " d " do"
+            # every local looks up the outermost variable and the previous local of its level
+            print "var number v" d "x0 = outer + x"
+            for (i = 1; i < perLevel; i++)
+                print "var number v" d "x" i " = v" d "x" i - 1 " + outer"
+        }
+        print "x = x + outer"
+        for (d = 0; d < depth; d++)
+            print "end"
+        print "    return x"
+        print "end"
+        print "return deep(1)"
+    }' > scopes.t
+    echo "depth $DEPTH:"
+    "$T" scopes.t --time-phases --no-cache 2>&1 | grep '^check:\|^codegen:'
+done
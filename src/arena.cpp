@@ -0,0 +1,33 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#include <cstdint>
+#include "arena.h"
+
+namespace t {
+
+    void *Arena::Allocate(size_t size, size_t alignment) {
+        auto address = (reinterpret_cast<uintptr_t>(Current) + alignment - 1) & ~(uintptr_t) (alignment - 1);
+        if (Current == nullptr || address + size > reinterpret_cast<uintptr_t>(End)) {
+            size_t blockSize = size + alignment > BlockSize ? size + alignment : BlockSize;
+            Blocks.push_back(std::make_unique<char[]>(blockSize));
+            Current = Blocks.back().get();
+            End = Current + blockSize;
+            address = (reinterpret_cast<uintptr_t>(Current) + alignment - 1) & ~(uintptr_t) (alignment - 1);
+        }
+        Current = reinterpret_cast<char *>(address + size);
+        BytesAllocated += size;
+        return reinterpret_cast<void *>(address);
+    }
+
+    void Arena::Reset() {
+        // destroy objects in reverse order of construction
+        for (auto it = Destructors.rbegin(); it != Destructors.rend(); it++)
+            it->destroy(it->object);
+        Destructors.clear();
+        Blocks.clear();
+        Current = End = nullptr;
+        BytesAllocated = 0;
+    }
+}
@@ -0,0 +1,56 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace t {
+
+    // Bump allocator: objects are placed one after another in large blocks and are all destroyed at once by Reset()
+    class Arena {
+        static constexpr size_t BlockSize = 64 * 1024;
+
+        struct Destructor {
+            void *object;
+            void (*destroy)(void *);
+        };
+
+        std::vector<std::unique_ptr<char[]>> Blocks;
+        std::vector<Destructor> Destructors;
+        char *Current = nullptr;
+        char *End = nullptr;
+        size_t BytesAllocated = 0;
+
+    public:
+        Arena() = default;
+
+        Arena(const Arena &) = delete;
+
+        Arena &operator=(const Arena &) = delete;
+
+        ~Arena() { Reset(); }
+
+        void *Allocate(size_t size, size_t alignment);
+
+        template<typename T, typename... Arguments>
+        T *make(Arguments &&... arguments) {
+            T *object = new(Allocate(sizeof(T), alignof(T))) T(std::forward<Arguments>(arguments)...);
+            if constexpr (!std::is_trivially_destructible_v<T>)
+                Destructors.push_back({object, [](void *object) { static_cast<T *>(object)->~T(); }});
+            return object;
+        }
+
+        // Destroys every object made in the arena and releases its memory
+        void Reset();
+
+        size_t getBytesAllocated() const { return BytesAllocated; }
+    };
+
+}
@@ -0,0 +1,129 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#include <llvm/ADT/ScopeExit.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/CodeGen/ParallelCG.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+#include "backend.h"
+
+using namespace std;
+using namespace llvm;
+
+namespace t {
+
+    namespace {
+        // More parts than functions would only add empty objects
+        unsigned CountParts(Module &M, unsigned Threads) {
+            unsigned Functions = 0;
+            for (auto &F: M)
+                Functions += !F.isDeclaration();
+            return max(1u, min(Threads, Functions));
+        }
+
+        // The host's linker only knows objects of the host's architecture, object format and operating system
+        bool HostCanLink(const Triple &Target) {
+            Triple Host(sys::getProcessTriple());
+            return Target.getArch() == Host.getArch() && Target.getObjectFormat() == Host.getObjectFormat() &&
+                   (Target.getOS() == Host.getOS() || (Target.isOSDarwin() && Host.isOSDarwin()));
+        }
+
+        Error EmitOnOneThread(Module &M, TargetMachine &TM, SmallVectorImpl<char> &Object) {
+            raw_svector_ostream Stream(Object);
+            legacy::PassManager Passes;
+            if (TM.addPassesToEmitFile(Passes, Stream, nullptr, CGFT_ObjectFile))
+                return createStringError(inconvertibleErrorCode(), "TargetMachine can't emit a file of this type");
+            Passes.run(M);
+            return Error::success();
+        }
+
+        // Links the objects into one relocatable object with `ld -r`
+        Error MergeObjects(StringRef Linker, ArrayRef<SmallVector<char, 0>> Parts, SmallVectorImpl<char> &Object) {
+            vector<string> Files;
+            auto RemoveFiles = make_scope_exit([&] {
+                for (auto &File: Files)
+                    sys::fs::remove(File);
+            });
+            for (auto &Part: Parts) {
+                SmallString<128> Path;
+                int FD;
+                if (auto EC = sys::fs::createTemporaryFile("t-part", "o", FD, Path))
+                    return make_error<StringError>("Can't create a temporary file for an object: " + EC.message(), EC);
+                Files.push_back(Path.str().str());
+                raw_fd_ostream Stream(FD, true);
+                Stream << StringRef(Part.data(), Part.size());
+                Stream.close();
+                if (Stream.has_error()) {
+                    auto EC = Stream.error();
+                    Stream.clear_error();
+                    return make_error<StringError>("Can't write " + Path + ": " + EC.message(), EC);
+                }
+            }
+            SmallString<128> Merged;
+            if (auto EC = sys::fs::createTemporaryFile("t-merged", "o", Merged))
+                return make_error<StringError>("Can't create a temporary file for an object: " + EC.message(), EC);
+            Files.push_back(Merged.str().str());
+
+            vector<StringRef> Arguments = {Linker, "-r", "-o", Merged};
+            for (size_t i = 0; i + 1 < Files.size(); i++)
+                Arguments.push_back(Files[i]);
+            string Message;
+            if (auto Status = sys::ExecuteAndWait(Linker, Arguments, None, {}, 0, 0, &Message))
+                return make_error<StringError>("Merging the objects with `" + Linker + " -r` failed" +
+                                               (Message.empty() ? " with status " + to_string(Status) : ": " + Message),
+                                               inconvertibleErrorCode());
+            auto Buffer = MemoryBuffer::getFile(Merged);
+            if (!Buffer)
+                return make_error<StringError>("Can't read " + Merged + ": " + Buffer.getError().message(),
+                                               Buffer.getError());
+            Object.append((*Buffer)->getBufferStart(), (*Buffer)->getBufferEnd());
+            return Error::success();
+        }
+    }
+
+    unsigned GetThreadCount(unsigned Requested) {
+        return Requested ? Requested : hardware_concurrency().compute_thread_count();
+    }
+
+    vector<orc::ThreadSafeModule> SplitForThreads(Module &M, unsigned Count) {
+        vector<orc::ThreadSafeModule> Parts;
+        // locals referenced from other parts become hidden symbols
+        SplitModule(M, CountParts(M, Count), [&](unique_ptr<Module> Part) {
+            // a context is only used by one thread at a time, so every part moves to one of its own
+            SmallVector<char, 0> Bitcode;
+            raw_svector_ostream Stream(Bitcode);
+            WriteBitcodeToFile(*Part, Stream);
+            auto Context = make_unique<LLVMContext>();
+            auto Parsed = cantFail(parseBitcodeFile(MemoryBufferRef(Stream.str(), Part->getName()), *Context));
+            Parts.emplace_back(move(Parsed), move(Context));
+        });
+        return Parts;
+    }
+
+    Error EmitObjectFile(Module &M, unsigned Threads, const function<unique_ptr<TargetMachine>()> &CreateTargetMachine,
+                        SmallVectorImpl<char> &Object) {
+        auto Linker = sys::findProgramByName("ld");
+        auto Parts = CountParts(M, Threads);
+        if (Parts == 1 || !Linker || !HostCanLink(Triple(M.getTargetTriple())))
+            return EmitOnOneThread(M, *CreateTargetMachine(), Object);
+
+        vector<SmallVector<char, 0>> Objects(Parts);
+        vector<unique_ptr<raw_svector_ostream>> Streams;
+        vector<raw_pwrite_stream *> Outputs;
+        for (auto &PartObject: Objects) {
+            Streams.push_back(make_unique<raw_svector_ostream>(PartObject));
+            Outputs.push_back(Streams.back().get());
+        }
+        splitCodeGen(M, Outputs, {}, CreateTargetMachine, CGFT_ObjectFile);
+        Streams.clear();
+        return MergeObjects(*Linker, Objects, Object);
+    }
+}
@@ -0,0 +1,29 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Target/TargetMachine.h>
+
+namespace t {
+
+    // Threads to compile with for --threads: Requested, or one per core for 0
+    unsigned GetThreadCount(unsigned Requested);
+
+    // Splits M into up to Count modules with contexts of their own, which the JIT can compile at the same time
+    std::vector<llvm::orc::ThreadSafeModule> SplitForThreads(llvm::Module &M, unsigned Count);
+
+    // Emits an object file for M into Object. With more than one thread, parts of M are compiled at the same time and
+    // their objects merged with `ld -r`; without a linker for the target M is compiled on one thread. Fails if the
+    // target can't emit objects or merging them fails.
+    llvm::Error EmitObjectFile(llvm::Module &M, unsigned Threads,
+                        const std::function<std::unique_ptr<llvm::TargetMachine>()> &CreateTargetMachine,
+                        llvm::SmallVectorImpl<char> &Object);
+}
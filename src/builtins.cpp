@@ -0,0 +1,76 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#include <cstring>
+#include <unordered_map>
+#include "builtins.h"
+#include "type.h"
+
+namespace t {
+
+    namespace {
+        using Kind = BuiltinKind;
+        using Memory = BuiltinMemory;
+
+        // Functions that can be called without being defined or declared. A function of the same name defined in the
+        // program takes precedence.
+        const Builtin Builtins[] = {
+                // Lists and strings
+                {"push", {"<list>", "<element>"}, "void", Kind::Inline, Memory::Any, true},
+                {"reserve", {"<list>", "int"}, "void", Kind::Inline, Memory::Any, true},
+                {"len", {"<sequence>"}, "<length>", Kind::Inline, Memory::Read, true},
+                {"concat", {"string", "string"}, "string", Kind::Runtime, Memory::Any, true, "t_string_concat"},
+                {"isEqual", {"string", "string"}, "bool", Kind::Runtime, Memory::Read, true, "t_string_equal"},
+                {"compare", {"string", "string"}, "i32", Kind::Runtime, Memory::Read, true, "t_string_compare"},
+                {"find", {"string", "string"}, "int", Kind::Runtime, Memory::Read, true, "t_string_find"},
+                {"count", {"string", "char"}, "int", Kind::Runtime, Memory::Read, true, "t_string_count"},
+                {"split", {"string", "char"}, "list of string", Kind::Runtime, Memory::Any, true, "t_string_split"},
+
+                // Math; tan has no intrinsic
+                {"sin", {"<float>"}, "<float>", Kind::Intrinsic, Memory::None, true, nullptr, llvm::Intrinsic::sin},
+                {"cos", {"<float>"}, "<float>", Kind::Intrinsic, Memory::None, true, nullptr, llvm::Intrinsic::cos},
+                {"tan", {"<float>"}, "<float>", Kind::Runtime, Memory::None, true, "tan"},
+                {"sqrt", {"<float>"}, "<float>", Kind::Intrinsic, Memory::None, true, nullptr, llvm::Intrinsic::sqrt},
+                {"exp", {"<float>"}, "<float>", Kind::Intrinsic, Memory::None, true, nullptr, llvm::Intrinsic::exp},
+                {"log", {"<float>"}, "<float>", Kind::Intrinsic, Memory::None, true, nullptr, llvm::Intrinsic::log},
+                {"pow", {"<float>", "<float>"}, "<float>", Kind::Intrinsic, Memory::None, true, nullptr,
+                 llvm::Intrinsic::pow},
+                {"fma", {"<float>", "<float>", "<float>"}, "<float>", Kind::Intrinsic, Memory::None, true, nullptr,
+                 llvm::Intrinsic::fma},
+
+                // Input and output; functions taking a file handle stop the program if it is invalid
+                {"printString", {"string"}, "void", Kind::Runtime, Memory::Any, true, "printString"},
+                {"printAscii", {"number"}, "void", Kind::Runtime, Memory::Any, true, "printAscii"},
+                {"printNumber", {"number"}, "void", Kind::Runtime, Memory::Any, true, "printNumber"},
+                {"printList", {"list of number", "string"}, "void", Kind::Runtime, Memory::Any, true, "printList"},
+                {"writeBytes", {"list of char"}, "void", Kind::Runtime, Memory::Any, true, "writeBytes"},
+                {"flush", {}, "void", Kind::Runtime, Memory::Any, true, "flush"},
+                {"input", {}, "string", Kind::Runtime, Memory::Any, true, "input"},
+                {"openFile", {"string"}, "int", Kind::Runtime, Memory::Any, true, "openFile"},
+                {"closeFile", {"int"}, "void", Kind::Runtime, Memory::Any, false, "closeFile"},
+                {"hasLine", {"int"}, "bool", Kind::Runtime, Memory::Any, false, "hasLine"},
+                {"readLine", {"int"}, "string", Kind::Runtime, Memory::Any, false, "readLine"},
+                {"parseNumber", {"string"}, "number", Kind::Runtime, Memory::Read, true, "parseNumber"},
+                {"parseInt", {"string"}, "int", Kind::Runtime, Memory::Read, true, "parseInt"},
+        };
+    }
+
+    const Builtin *GetBuiltin(InternedString Name) {
+        static const auto Table = [] {
+            std::unordered_map<InternedString, const Builtin *> Table;
+            for (auto &Entry: Builtins)
+                Table[InternedString::get(Entry.Name)] = &Entry;
+            return Table;
+        }();
+        auto Entry = Table.find(Name);
+        return Entry == Table.end() ? nullptr : Entry->second;
+    }
+
+    Type *GetBuiltinType(const char *Name) {
+        static const char ListOf[] = "list of ";
+        if (strncmp(Name, ListOf, sizeof(ListOf) - 1) == 0)
+            return Types.get(Types.ListName, GetBuiltinType(Name + sizeof(ListOf) - 1));
+        return Types.get(Name);
+    }
+}
@@ -0,0 +1,51 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#pragma once
+
+#include <vector>
+#include <llvm/IR/Intrinsics.h>
+#include "interner.h"
+
+namespace t {
+    class Type;
+
+    enum class BuiltinKind : uint8_t {
+        Intrinsic,  // an LLVM intrinsic, overloaded on the result type
+        Inline,     // IR emitted by Call::codegenBuiltin
+        Runtime,    // a function of corefn or the C library
+    };
+
+    // What a builtin does to memory, which the type checker and LLVM rely on
+    enum class BuiltinMemory : uint8_t {
+        None,
+        Read,
+        Any,
+    };
+
+    // Parameters and results are type names, or patterns that are matched against the arguments of a call:
+    //  <float>     number or f32; f32 if any <float> argument is f32, and then all of them are
+    //  <list>      a list of any type
+    //  <element>   the element type of the <list> argument
+    //  <sequence>  a list or a string
+    //  <length>    an int that, like a number literal, is a number unless an int is expected
+    struct Builtin {
+        const char *Name;
+        std::vector<const char *> Parameters;
+        const char *Result;
+        BuiltinKind Kind;
+        BuiltinMemory Memory;
+        bool WillReturn;
+        // Runtime: the C symbol; for f32 the C library convention of an f suffix is followed
+        const char *Symbol = nullptr;
+        // Intrinsic: the intrinsic
+        llvm::Intrinsic::ID Intrinsic = llvm::Intrinsic::not_intrinsic;
+    };
+
+    // Returns the builtin called Name, or nullptr if there is none
+    const Builtin *GetBuiltin(InternedString Name);
+
+    // Returns the type a type name of a signature stands for
+    Type *GetBuiltinType(const char *Name);
+}
@@ -0,0 +1,132 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include "cache.h"
+
+using namespace std;
+using namespace llvm;
+
+namespace t {
+
+    namespace {
+        string ToHex(MD5 &Hash) {
+            MD5::MD5Result Result;
+            Hash.final(Result);
+            return Result.digest().str().str();
+        }
+
+        string DigestSource(StringRef Contents) {
+            MD5 Hash;
+            Hash.update(Contents);
+            return ToHex(Hash);
+        }
+
+        // Writes Contents through a temporary file, so that programs running at the same time never read a partial file
+        void WriteAtomically(const string &Path, StringRef Contents) {
+            SmallString<128> Temporary;
+            int FD;
+            if (sys::fs::createUniqueFile(Path + ".%%%%%%.tmp", FD, Temporary))
+                return;
+            raw_fd_ostream Stream(FD, true);
+            Stream << Contents;
+            Stream.close();
+            if (Stream.has_error()) {
+                Stream.clear_error();
+                sys::fs::remove(Temporary);
+                return;
+            }
+            if (sys::fs::rename(Temporary, Path))
+                sys::fs::remove(Temporary);
+        }
+    }
+
+    ObjectFileCache::ObjectFileCache(string directory, const string &Options) : Directory(move(directory)) {
+        MD5 Hash;
+        Hash.update(Options);
+        OptionsHash = ToHex(Hash);
+        sys::fs::create_directories(Directory);
+    }
+
+    string ObjectFileCache::ManifestPath() const {
+        SmallString<128> Path(Directory);
+        sys::path::append(Path, OptionsHash + ".manifest");
+        return Path.str().str();
+    }
+
+    string ObjectFileCache::ObjectPath() const {
+        SmallString<128> Path(Directory);
+        sys::path::append(Path, Key + ".o");
+        return Path.str().str();
+    }
+
+    void ObjectFileCache::HashSources(const map<string, string> &Digests) {
+        MD5 Hash;
+        Hash.update(OptionsHash);
+        for (auto &[File, Digest]: Digests) {
+            // the length keeps the boundary between path and digest unambiguous
+            Hash.update(File);
+            Hash.update(utostr(File.size()) + ":" + Digest);
+        }
+        Key = ToHex(Hash);
+    }
+
+    unique_ptr<MemoryBuffer> ObjectFileCache::Lookup() {
+        auto Manifest = MemoryBuffer::getFile(ManifestPath());
+        if (!Manifest)
+            return nullptr;
+        SmallVector<StringRef, 8> Lines;
+        (*Manifest)->getBuffer().split(Lines, '\n', -1, false);
+        map<string, string> Digests;
+        for (auto Line: Lines) {
+            auto Contents = MemoryBuffer::getFile(Line);
+            if (!Contents)
+                return nullptr;
+            Digests[Line.str()] = DigestSource((*Contents)->getBuffer());
+        }
+        if (Digests.empty())
+            return nullptr;
+        HashSources(Digests);
+        return getObject(nullptr);
+    }
+
+    void ObjectFileCache::AddSource(const string &File, StringRef Contents) {
+        Sources[File] = DigestSource(Contents);
+    }
+
+    void ObjectFileCache::SetSources() {
+        HashSources(Sources);
+        string Manifest;
+        for (auto &Source: Sources)
+            Manifest += Source.first + "\n";
+        WriteAtomically(ManifestPath(), Manifest);
+    }
+
+    void ObjectFileCache::Store(MemoryBufferRef Object) {
+        if (!Key.empty())
+            WriteAtomically(ObjectPath(), Object.getBuffer());
+    }
+
+    unique_ptr<MemoryBuffer> ObjectFileCache::getObject(const llvm::Module *) {
+        if (Key.empty())
+            return nullptr;
+        auto Object = MemoryBuffer::getFile(ObjectPath());
+        if (!Object)
+            return nullptr;
+        return move(*Object);
+    }
+
+    string GetDefaultCacheDirectory() {
+        SmallString<128> Path;
+        if (!sys::path::cache_directory(Path))
+            sys::path::system_temp_directory(true, Path);
+        sys::path::append(Path, "t");
+        return Path.str().str();
+    }
+}
@@ -0,0 +1,55 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+namespace t {
+
+    // Compiled programs on disk, keyed by a hash of their source files and of the compiler, options and target they
+    // were compiled with. A manifest per program and options lists the source files, so an unchanged program is found
+    // without parsing it. Failing to read or write the cache only means compiling again.
+    class ObjectFileCache : public llvm::ObjectCache {
+        std::string Directory;
+        std::string OptionsHash;
+        std::string Key;    // hash of the options and sources, empty until they are known
+        // Digests of the source files of the program being compiled, by path
+        std::map<std::string, std::string> Sources;
+
+        std::string ManifestPath() const;
+
+        std::string ObjectPath() const;
+
+        // Sets Key from the digests of the source files
+        void HashSources(const std::map<std::string, std::string> &Digests);
+
+    public:
+
+        // Options describes everything except the sources that the compiled object depends on
+        ObjectFileCache(std::string directory, const std::string &Options);
+
+        // Returns the object compiled from the sources in the manifest, if none of them has changed since
+        std::unique_ptr<llvm::MemoryBuffer> Lookup();
+
+        // Records a source file of the program being compiled from the buffer it was read into, so it isn't read again
+        void AddSource(const std::string &File, llvm::StringRef Contents);
+
+        // Stores the object under the sources added so far from now on, and lists them in the manifest
+        void SetSources();
+
+        void Store(llvm::MemoryBufferRef Object);
+
+        void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef Object) override { Store(Object); }
+
+        std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override;
+    };
+
+    // Default directory of the cache, e.g. ~/.cache/t
+    std::string GetDefaultCacheDirectory();
+}
@@ -5,464 +5,925 @@
 #include "nodes.h"
 #include "error.h"
 #include <map>
+#include <unordered_map>
+#include <cmath>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
 #include "type.h"
 #include "symbols.h"
+#include "builtins.h"
+#include "codegen.h"
 
 using namespace std;
 using namespace llvm;
 
 namespace t {
 
-    unique_ptr<LLVMContext> Context;
-    unique_ptr<IRBuilder<>> Builder;
-    unique_ptr<Module> Module;
-    Symbols Symbols;
+    // Allocas go to the start of the entry block, so variables defined in loops don't grow the stack on every iteration
+    AllocaInst *CreateAlloca(CompilationSession &Session, llvm::Function *Function, llvm::Type *Type,
+                             const string Name = "", int Size = 1) {
+        IRBuilder<> EntryBuilder(&Function->getEntryBlock(), Function->getEntryBlock().begin());
+        return EntryBuilder.CreateAlloca(Type, ConstantInt::get(llvm::Type::getInt32Ty(*Session.Context), Size), Name);
+    }
+
+    // Declares a function of the corefn runtime
+    FunctionCallee GetRuntimeFunction(CompilationSession &Session, StringRef Name, llvm::Type *Result,
+                                      ArrayRef<llvm::Type *> Parameters) {
+        return Session.Module->getOrInsertFunction(Name, FunctionType::get(Result, Parameters, false));
+    }
+
+    // List headers and list elements never alias, which lets LLVM keep the length and data pointer of a list in
+    // registers while its elements are written. Other accesses stay untagged and may alias anything.
+    template<typename T>
+    T *TagListAccess(CompilationSession &Session, T *Access, bool Header) {
+        MDBuilder MDB(*Session.Context);
+        auto TypeNode = MDB.createTBAAScalarTypeNode(Header ? "list header" : "list element", MDB.createTBAARoot("t"));
+        Access->setMetadata(LLVMContext::MD_tbaa, MDB.createTBAAStructTagNode(TypeNode, TypeNode, 0));
+        return Access;
+    }
+
+    // Field of a list header: 0 is the length, 1 the capacity and 2 the data pointer
+    LoadInst *LoadListField(CompilationSession &Session, Value *List, unsigned Field, const Twine &Name = "") {
+        auto Header = GetListHeaderType(*Session.Context);
+        auto Address = Session.Builder->CreateStructGEP(Header, List, Field);
+        return TagListAccess(Session, Session.Builder->CreateLoad(Header->getElementType(Field), Address, Name), true);
+    }
+
+    // Pointer to the first element of a list
+    Value *GetListElements(CompilationSession &Session, Value *List, llvm::Type *ElementType) {
+        return Session.Builder->CreateBitCast(LoadListField(Session, List, 2, "data"), ElementType->getPointerTo(),
+                                              "elements");
+    }
 
-    void InitializeLLVM() {
-        Context = make_unique<LLVMContext>();
-        Module = make_unique<llvm::Module>("t", *Context);
-        Builder = make_unique<IRBuilder<>>(*Context);
+    // Branches to InRangeBlock if Index < Length (unsigned) and to OutOfRangeBlock otherwise
+    void CreateBoundsCheck(CompilationSession &Session, Value *Index, Value *Length, BasicBlock *InRangeBlock,
+                           BasicBlock *OutOfRangeBlock) {
+        auto InRange = Session.Builder->CreateICmpULT(Index, Length, "in_range");
+        auto Branch = Session.Builder->CreateCondBr(InRange, InRangeBlock, OutOfRangeBlock,
+                                                    MDBuilder(*Session.Context).createBranchWeights(1 << 20, 1));
+        Branch->setMetadata(BoundsCheckMetadata, MDNode::get(*Session.Context, {}));
     }
 
-    AllocaInst *CreateAlloca(llvm::Function *Function, llvm::Type *Type, const string Name = "", int Size = 1) {
-        return Builder->CreateAlloca(Type, ConstantInt::get(llvm::Type::getDoubleTy(*Context), Size), Name);
+    // Stops the program with an error unless Index < Length; both are i64
+    void CreateTrappingBoundsCheck(CompilationSession &Session, Value *Index, Value *Length) {
+        auto Function = Session.Builder->GetInsertBlock()->getParent();
+        auto FailBlock = BasicBlock::Create(*Session.Context, "out_of_bounds", Function);
+        auto ContinueBlock = BasicBlock::Create(*Session.Context, "in_bounds", Function);
+        CreateBoundsCheck(Session, Index, Length, ContinueBlock, FailBlock);
+
+        Session.Builder->SetInsertPoint(FailBlock);
+        auto Int64 = llvm::Type::getInt64Ty(*Session.Context);
+        auto OutOfBounds = GetRuntimeFunction(Session, "t_index_out_of_bounds", llvm::Type::getVoidTy(*Session.Context),
+                                              {Int64, Int64});
+        cast<llvm::Function>(OutOfBounds.getCallee())->setDoesNotReturn();
+        Session.Builder->CreateCall(OutOfBounds, {Index, Length});
+        Session.Builder->CreateUnreachable();
+
+        Session.Builder->SetInsertPoint(ContinueBlock);
     }
 
-    pair<Value *, llvm::Type *> Variable::getAddressAndType() {
-        auto variable = Symbols.GetVariable(Name);
-        return make_pair(variable.address, variable.type->GetLLVMType());
+    // Strings are laid out like the runtime's: the length in the 8 bytes in front of the first byte
+    Value *CreateStringLength(CompilationSession &Session, Value *String) {
+        auto Int64 = llvm::Type::getInt64Ty(*Session.Context);
+        auto Address = Session.Builder->CreateBitCast(String, Int64->getPointerTo());
+        auto LengthAddress = Session.Builder->CreateGEP(Int64, Address, ConstantInt::getSigned(Int64, -1));
+        return Session.Builder->CreateAlignedLoad(Int64, LengthAddress, Align(8), "length");
     }
 
-    pair<Value *, llvm::Type *> Call::getAddressAndType() {
-        auto function = Symbols.GetFunction(Callee);
-        return make_pair(codegen(), function.type->GetLLVMType());
+    // String literals are constant globals holding the length, the bytes and a terminating zero
+    Constant *CreateStringLiteral(CompilationSession &Session, StringRef Text, StringRef Name = ".str") {
+        auto Int32 = llvm::Type::getInt32Ty(*Session.Context);
+        auto Literal = ConstantStruct::getAnon({ConstantInt::get(llvm::Type::getInt64Ty(*Session.Context), Text.size()),
+                                                ConstantDataArray::getString(*Session.Context, Text)});
+        auto Global = new GlobalVariable(*Session.Module, Literal->getType(), true, GlobalValue::PrivateLinkage,
+                                         Literal, Name);
+        Global->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+        Global->setAlignment(Align(8));
+        Constant *Indices[] = {ConstantInt::get(Int32, 0), ConstantInt::get(Int32, 1), ConstantInt::get(Int32, 0)};
+        return ConstantExpr::getInBoundsGetElementPtr(Literal->getType(), Global, Indices);
     }
 
-    pair<Value *, llvm::Type *> Indexing::getAddressAndType() {
-        auto ObjectAddressAndType = Object->getAddressAndType();
+    // The one empty string of the module, which every string that was never assigned points to
+    Constant *GetEmptyString(CompilationSession &Session) {
+        auto Global = Session.Module->getNamedGlobal("empty_string");
+        if (!Global)
+            return CreateStringLiteral(Session, "", "empty_string");
+        auto Int32 = llvm::Type::getInt32Ty(*Session.Context);
+        Constant *Indices[] = {ConstantInt::get(Int32, 0), ConstantInt::get(Int32, 1), ConstantInt::get(Int32, 0)};
+        return ConstantExpr::getInBoundsGetElementPtr(Global->getValueType(), Global, Indices);
+    }
+
+    // Value of a variable, list element or member that was never assigned: zero, except for strings, which start out
+    // empty so that they have a length like any other string
+    Constant *CreateDefaultValue(CompilationSession &Session, t::Type *Type) {
+        if (Type == Types.String)
+            return GetEmptyString(Session);
+        auto LLVMType = Type->GetLLVMType(Session);
+        auto *Structure = isa<StructType>(LLVMType) ? Session.Symbols.GetStructure(Type->name) : nullptr;
+        if (!Structure)
+            return Constant::getNullValue(LLVMType);
+        vector<Constant *> Members;
+        for (auto &Member: Structure->members)
+            Members.push_back(CreateDefaultValue(Session, Member.second));
+        return ConstantStruct::get(cast<StructType>(LLVMType), Members);
+    }
+
+    // C expects bools and chars widened by the caller
+    void AddIntegerExtensions(llvm::Function *Function) {
+        for (auto &Argument: Function->args()) {
+            if (Argument.getType()->isIntegerTy(1) || Argument.getType()->isIntegerTy(8))
+                Argument.addAttr(Attribute::ZExt);
+        }
+        if (Function->getReturnType()->isIntegerTy(1) || Function->getReturnType()->isIntegerTy(8))
+            Function->addRetAttr(Attribute::ZExt);
+    }
+
+    // Declares the function implementing a runtime builtin, with what the registry knows about it
+    FunctionCallee GetBuiltinFunction(CompilationSession &Session, const Builtin &Entry, llvm::Type *Result,
+                                      ArrayRef<llvm::Type *> Parameters) {
+        string Symbol = Entry.Symbol;
+        if (Result->isFloatTy())
+            Symbol += "f";
+        bool Declared = Session.Module->getFunction(Symbol);
+        auto Callee = GetRuntimeFunction(Session, Symbol, Result, Parameters);
+        auto Function = dyn_cast<llvm::Function>(Callee.getCallee());
+        if (Declared || !Function)
+            return Callee;
+        Function->setDoesNotThrow();
+        if (Entry.Memory == BuiltinMemory::None)
+            Function->setDoesNotAccessMemory();
+        else if (Entry.Memory == BuiltinMemory::Read) {
+            Function->setOnlyReadsMemory();
+            for (unsigned i = 0; i < Parameters.size(); i++) {
+                if (Parameters[i]->isPointerTy())
+                    Function->addParamAttr(i, Attribute::NoCapture);
+            }
+        }
+        if (Entry.WillReturn)
+            Function->addFnAttr(Attribute::WillReturn);
+        AddIntegerExtensions(Function);
+        return Callee;
+    }
+
+    // Allocations from here on go to a new region, until it is left
+    void EnterRegion(CompilationSession &Session) {
+        auto Enter = GetRuntimeFunction(Session, "t_region_enter", llvm::Type::getInt64Ty(*Session.Context), {});
+        Session.RegionMarks.push_back(Session.Builder->CreateCall(Enter, {}, "region"));
+    }
+
+    // Releases the region Mark and all regions entered after it
+    void CreateRegionLeave(CompilationSession &Session, Value *Mark) {
+        auto Leave = GetRuntimeFunction(Session, "t_region_leave", llvm::Type::getVoidTy(*Session.Context),
+                                        {llvm::Type::getInt64Ty(*Session.Context)});
+        Session.Builder->CreateCall(Leave, {Mark});
+    }
+
+    // Leaves the innermost region at the end of its block, unless the block already returned
+    void LeaveRegion(CompilationSession &Session) {
+        if (!Session.Builder->GetInsertBlock()->getTerminator())
+            CreateRegionLeave(Session, Session.RegionMarks.back());
+        Session.RegionMarks.pop_back();
+    }
+
+    // Index of an Indexing operation as an integer of IndexType; integer indices need no float conversion. Numbers are
+    // converted as signed, so a negative one stays negative and fails the bounds checks instead of becoming poison.
+    Value *CreateIndex(CompilationSession &Session, Expression *Index, llvm::Type *IndexType) {
+        auto *Value = Index->codegen(Session);
+        if (Index->type->isUnsigned())
+            return Session.Builder->CreateZExtOrTrunc(Value, IndexType);
+        if (Index->type->isInteger())
+            return Session.Builder->CreateSExtOrTrunc(Value, IndexType);
+        return Session.Builder->CreateFPToSI(Value, IndexType);
+    }
+
+    // Turns a condition of any numeric type into an i1
+    Value *CreateCondition(CompilationSession &Session, Value *Value, const Twine &Name = "condition") {
+        auto *Type = Value->getType();
+        if (Type->isIntegerTy(1))
+            return Value;
+        if (Type->isIntegerTy())
+            return Session.Builder->CreateICmpNE(Value, ConstantInt::get(Type, 0), Name);
+        return Session.Builder->CreateFCmpONE(Value, ConstantFP::get(Type, 0.0), Name);
+    }
+
+    pair<Value *, llvm::Type *> Variable::getAddressAndType(CompilationSession &Session) {
+        auto *variable = Session.Symbols.GetVariable(Name);
+        return make_pair(variable->address, variable->type->GetLLVMType(Session));
+    }
+
+    pair<Value *, llvm::Type *> Call::getAddressAndType(CompilationSession &Session) {
+        auto *function = Session.Symbols.GetFunction(Callee);
+        return make_pair(codegen(Session), function->type->GetLLVMType(Session));
+    }
+
+    pair<Value *, llvm::Type *> Indexing::getAddressAndType(CompilationSession &Session) {
         if (!Object->type->isDynamicallyIndexable()){
-            auto index = Builder->CreateFPToUI(Index->codegen(), llvm::Type::getInt16Ty(*Context));
-            auto Address = Builder->CreateGEP(ObjectAddressAndType.second, ObjectAddressAndType.first, index);
+            auto ObjectAddressAndType = Object->getAddressAndType(Session);
+            auto index = CreateIndex(Session, Index, llvm::Type::getInt64Ty(*Session.Context));
+            if (Session.CheckedIndexing)
+                CreateTrappingBoundsCheck(Session, index, ConstantInt::get(index->getType(), Object->type->size));
+            auto Address = Session.Builder->CreateGEP(ObjectAddressAndType.second, ObjectAddressAndType.first, index);
             return {Address, ObjectAddressAndType.second};
         }
-        else if (Object->type->type == "string"){
-            auto index = Builder->CreateFPToUI(Index->codegen(), llvm::Type::getInt32Ty(*Context));
-            auto Alloca = CreateAlloca(Builder->GetInsertBlock()->getParent(), llvm::Type::getInt8Ty(*Context), "", 2);
-            auto StringAddress = Builder->CreateLoad(llvm::Type::getInt8PtrTy(*Context), ObjectAddressAndType.first);
-            auto Address = Builder->CreateGEP(llvm::Type::getInt8Ty(*Context), StringAddress, index);
-            Builder->CreateMemCpyInline(Alloca, MaybeAlign(), Address, MaybeAlign(), ConstantInt::get(llvm::Type::getInt16Ty(*Context), 1), false);
-            auto NullTerminatorAddress = Builder->CreateGEP(Alloca, ConstantInt::get(llvm::Type::getInt32Ty(*Context), 1));
-            Builder->CreateStore(ConstantInt::get(llvm::Type::getInt8Ty(*Context), 0), NullTerminatorAddress);
-            auto AddressOfAlloca = CreateAlloca(Builder->GetInsertBlock()->getParent(), llvm::Type::getInt8PtrTy(*Context));
-            Builder->CreateStore(Alloca, AddressOfAlloca);
-            return {AddressOfAlloca, ObjectAddressAndType.second};
+        else if (Object->type == Types.String){
+            // the address of the byte itself, no copy
+            auto Char = llvm::Type::getInt8Ty(*Session.Context);
+            auto index = CreateIndex(Session, Index, llvm::Type::getInt64Ty(*Session.Context));
+            auto StringAddress = Object->codegen(Session);
+            if (Session.CheckedIndexing)
+                CreateTrappingBoundsCheck(Session, index, CreateStringLength(Session, StringAddress));
+            return {Session.Builder->CreateGEP(Char, StringAddress, index), Char};
+        }
+
+        // Lists grow to fit any index they are accessed with, so the bounds check is a single, rarely taken branch
+        auto Function = Session.Builder->GetInsertBlock()->getParent();
+        auto Int64 = llvm::Type::getInt64Ty(*Session.Context);
+        auto List = Object->codegen(Session);
+        auto index = CreateIndex(Session, Index, Int64);
+        auto Length = LoadListField(Session, List, 0, "length");
+        auto GrowBlock = BasicBlock::Create(*Session.Context, "grow", Function);
+        auto ContinueBlock = BasicBlock::Create(*Session.Context, "continue", Function);
+        CreateBoundsCheck(Session, index, Length, ContinueBlock, GrowBlock);
+
+        Session.Builder->SetInsertPoint(GrowBlock);
+        auto NewLength = Session.Builder->CreateAdd(index, ConstantInt::get(Int64, 1), "new_length");
+        auto Type = Object->type->subtype->GetLLVMType(Session);
+        auto BytePointer = llvm::Type::getInt8PtrTy(*Session.Context);
+        // new elements are copies of the default element, unless that is all zeros like the memory they get
+        Constant *Fill = ConstantPointerNull::get(BytePointer);
+        auto Default = CreateDefaultValue(Session, Object->type->subtype);
+        if (!Default->isNullValue()) {
+            auto Name = "default." + Object->type->subtype->name.str();
+            auto Global = Session.Module->getNamedGlobal(Name);
+            if (!Global) {
+                Global = new GlobalVariable(*Session.Module, Type, true, GlobalValue::PrivateLinkage, Default, Name);
+                Global->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+            }
+            Fill = ConstantExpr::getBitCast(Global, BytePointer);
         }
+        auto Resize = GetRuntimeFunction(Session, "t_list_resize", llvm::Type::getVoidTy(*Session.Context),
+                                         {List->getType(), Int64, BytePointer});
+        Session.Builder->CreateCall(Resize, {List, NewLength, Fill});
+        Session.Builder->CreateBr(ContinueBlock);
 
-        auto Function = Builder->GetInsertBlock()->getParent();
-
-        auto SizeAddress = Builder->CreateGEP(ObjectAddressAndType.first, {
-            ConstantInt::get(llvm::Type::getInt32Ty(*Context), 0),
-            ConstantInt::get(llvm::Type::getInt32Ty(*Context), 0), // Pointer to size
-        });
-        auto AllocaAddress = Builder->CreateGEP(ObjectAddressAndType.first, {
-                ConstantInt::get(llvm::Type::getInt32Ty(*Context), 0),
-                ConstantInt::get(llvm::Type::getInt32Ty(*Context), 1), // Pointer to Pointer to Data
-        });
-
-        auto index = Builder->CreateFPToUI(Index->codegen(), llvm::Type::getInt32Ty(*Context));
-        auto Size = Builder->CreateLoad(SizeAddress); // get current size of the list
-        auto newSize = Builder->CreateAdd(index, ConstantInt::get(llvm::Type::getInt32Ty(*Context), 1), "new_size");
-        auto Condition = Builder->CreateICmpUGT(newSize, Size);
-        auto ResizeBlock = BasicBlock::Create(*Context, "resize", Function);
-        auto ContinueBlock = BasicBlock::Create(*Context, "continue", Function);
-        Builder->CreateCondBr(Condition, ResizeBlock, ContinueBlock);
-
-        Builder->SetInsertPoint(ResizeBlock);
-        auto oldAlloca = Builder->CreateLoad(AllocaAddress, "old_alloca");
-        auto newAlloca = Builder->CreateAlloca(Object->type->subtype->GetLLVMType(), newSize, "new_alloca"); // create new allocation to expand to size necessary
-        auto SizeOfSingleElement = Module->getDataLayout().getTypeAllocSize(Object->type->subtype->GetLLVMType());
-        auto SizeInBytes = Builder->CreateMul(Size, ConstantInt::get(llvm::Type::getInt32Ty(*Context), SizeOfSingleElement));
-        auto memmoveInstruction = Builder->CreateMemMove(newAlloca, MaybeAlign(), oldAlloca, MaybeAlign(), SizeInBytes);
-        Builder->CreateStore(newAlloca, AllocaAddress); // store new address
-        Builder->CreateStore(newSize, SizeAddress);   // update size
-        Builder->CreateBr(ContinueBlock);
-
-        Builder->SetInsertPoint(ContinueBlock);
-        auto Type = Object->type->subtype->GetLLVMType();
-        auto Alloca = Builder->CreateLoad(AllocaAddress);
-        auto Address = Builder->CreateGEP(Alloca, index);
+        Session.Builder->SetInsertPoint(ContinueBlock);
+        auto Address = Session.Builder->CreateGEP(Type, GetListElements(Session, List, Type), index);
         return {Address, Type};
     }
 
-    pair<Value *, llvm::Type *> Member::getAddressAndType() {
-        auto object = Object->getAddressAndType();
-        auto Structure = Symbols.GetStructure(Object->type->type);
-        for (int i = 0; i < Structure.members.size(); i++) {
-            auto Member = Structure.members[i];
+    pair<Value *, llvm::Type *> Member::getAddressAndType(CompilationSession &Session) {
+        auto object = Object->getAddressAndType(Session);
+        auto *Structure = Session.Symbols.GetStructure(Object->type->name);
+        for (size_t i = 0; i < Structure->members.size(); i++) {
+            auto &Member = Structure->members[i];
             if (Member.first == Name) {
-                auto MemberType = Member.second->GetLLVMType();
-                auto MemberPointer = Builder->CreateGEP(object.first,{
-                    ConstantInt::get(llvm::Type::getInt32Ty(*Context),0), // 'pierce' through pointer
-                    ConstantInt::get(llvm::Type::getInt32Ty(*Context), i)
+                auto MemberType = Member.second->GetLLVMType(Session);
+                auto MemberPointer = Session.Builder->CreateGEP(object.first,{
+                    ConstantInt::get(llvm::Type::getInt32Ty(*Session.Context),0), // 'pierce' through pointer
+                    ConstantInt::get(llvm::Type::getInt32Ty(*Session.Context), i)
                 });
                 return {MemberPointer, MemberType};
             }
         }
-        LogError(location, "Member "+Name + " not found in type " + Object->type->type);
-
+        LogError(location, "Member "+Name.str() + " not found in type " + Object->type->str());
+        StopCompilation();
     }
 
-    Value *Negative::codegen() {
-        auto *Value = expression->codegen();
+    Value *Negative::codegen(CompilationSession &Session) {
+        auto *Value = expression->codegen(Session);
         if (!Value) {
             return nullptr;
         }
-        return Builder->CreateFMul(ConstantFP::get(*Context, APFloat(-1.0)), Value, "neg");
+        if (type->isInteger())
+            return Session.Builder->CreateNeg(Value, "neg");
+        return Session.Builder->CreateFMul(ConstantFP::get(Value->getType(), -1.0), Value, "neg");
     }
 
-    Value *Number::codegen() {
-        return ConstantFP::get(*Context, APFloat(Value));
+    Value *Number::codegen(CompilationSession &Session) {
+        if (type->isInteger())
+            return ConstantInt::get(type->GetLLVMType(Session), (int64_t) Value, true);
+        return ConstantFP::get(type->GetLLVMType(Session), Value);
     }
 
-    Value *Bool::codegen() {
+    Value *Cast::codegen(CompilationSession &Session) {
+        auto *Value = this->Value->codegen(Session);
+        if (!Value)
+            return nullptr;
+        auto *From = this->Value->type;
+        auto *DestinationType = type->GetLLVMType(Session);
+        if (From == type)
+            return Value;
+        if (From->isInteger() && type->isInteger())
+            return Session.Builder->CreateIntCast(Value, DestinationType, !From->isUnsigned());
+        if (From->isInteger())
+            return From->isUnsigned() ? Session.Builder->CreateUIToFP(Value, DestinationType)
+                                      : Session.Builder->CreateSIToFP(Value, DestinationType);
+        if (type->isInteger())
+            return type->isUnsigned() ? Session.Builder->CreateFPToUI(Value, DestinationType)
+                                      : Session.Builder->CreateFPToSI(Value, DestinationType);
+        return Session.Builder->CreateFPCast(Value, DestinationType);
+    }
+
+    Value *Bool::codegen(CompilationSession &Session) {
         if (Value)
-            return ConstantInt::getTrue(*Context);
+            return ConstantInt::getTrue(*Session.Context);
         else
-            return ConstantInt::getFalse(*Context);
+            return ConstantInt::getFalse(*Session.Context);
+    }
+
+    Value *Character::codegen(CompilationSession &Session) {
+        return ConstantInt::get(llvm::Type::getInt8Ty(*Session.Context), Value);
     }
 
-    Value *String::codegen() {
-        return Builder->CreateGlobalStringPtr(StringRef(Value));
+    Value *String::codegen(CompilationSession &Session) {
+        return CreateStringLiteral(Session, Value.str());
     }
 
-    Value *Variable::codegen() {
-        auto AddressAndType = getAddressAndType();
-        return Builder->CreateLoad(AddressAndType.second, AddressAndType.first);
+    Value *Variable::codegen(CompilationSession &Session) {
+        auto AddressAndType = getAddressAndType(Session);
+        return Session.Builder->CreateLoad(AddressAndType.second, AddressAndType.first);
     }
 
-    Value *Indexing::codegen() {
-        auto AddressAndType = getAddressAndType();
-        return Builder->CreateLoad(AddressAndType.second, AddressAndType.first);
+    Value *Indexing::codegen(CompilationSession &Session) {
+        auto AddressAndType = getAddressAndType(Session);
+        auto Load = Session.Builder->CreateLoad(AddressAndType.second, AddressAndType.first);
+        if (isListElement())
+            TagListAccess(Session, Load, false);
+        return Load;
     }
 
-    Value *VariableDefinition::codegen() {
-        auto Function = Builder->GetInsertBlock()->getParent();
+    Value *VariableDefinition::codegen(CompilationSession &Session) {
+        auto Function = Session.Builder->GetInsertBlock()->getParent();
 
-        auto Alloca = CreateAlloca(Function, type->GetLLVMType(), Name, type->size);
-        Symbols.CreateVariable(Name, type, Alloca);
-        if (!Value)
-            return Builder->CreateStore(Constant::getNullValue(type->GetLLVMType()), Alloca);
+        auto Alloca = CreateAlloca(Session, Function, type->GetLLVMType(Session), Name.str(), type->size);
+        Session.Symbols.CreateVariable(Name, type, Alloca);
+        if (!Value && type->name == Types.ListName) {
+            auto Int64 = llvm::Type::getInt64Ty(*Session.Context);
+            auto NewList = GetRuntimeFunction(Session, "t_list_new", type->GetLLVMType(Session), {Int64});
+            auto ElementSize = ConstantExpr::getSizeOf(type->subtype->GetLLVMType(Session));
+            return Session.Builder->CreateStore(Session.Builder->CreateCall(NewList, {ElementSize}), Alloca);
+        }
+        if (!Value) {
+            // a fixed-size array has the LLVM type of its elements and is allocated with room for size of them
+            auto Default = CreateDefaultValue(Session, type->size == 1 ? type : Types.get(type->name, type->subtype));
+            if (type->size == 1 || Default->isNullValue())
+                return Session.Builder->CreateStore(Default, Alloca);
+            auto ElementType = type->GetLLVMType(Session);
+            llvm::Value *Last = nullptr;
+            for (int i = 0; i < type->size; i++)
+                Last = Session.Builder->CreateStore(Default, Session.Builder->CreateConstInBoundsGEP1_64(ElementType,
+                                                                                                        Alloca, i));
+            return Last;
+        }
         llvm::Value *initialValue;
-        initialValue = Value->codegen();
+        initialValue = Value->codegen(Session);
         if (!initialValue)
             return nullptr;
-        return Builder->CreateStore(initialValue, Alloca);
+        return Session.Builder->CreateStore(initialValue, Alloca);
+    }
+
+    Value *Call::codegenBuiltin(CompilationSession &Session) {
+        vector<Value *> ArgumentValues;
+        for (auto *Argument: Arguments) {
+            auto Value = Argument->codegen(Session);
+            if (!Value)
+                return nullptr;
+            ArgumentValues.push_back(Value);
+        }
+        auto Type = (IntegerResult ? IntegerResult : type)->GetLLVMType(Session);
+        if (BuiltinFunction->Kind == BuiltinKind::Intrinsic)
+            return Session.Builder->CreateIntrinsic(BuiltinFunction->Intrinsic, {Type}, ArgumentValues);
+        if (BuiltinFunction->Kind == BuiltinKind::Runtime) {
+            vector<llvm::Type *> ParameterTypes;
+            for (auto *Value: ArgumentValues)
+                ParameterTypes.push_back(Value->getType());
+            return Session.Builder->CreateCall(GetBuiltinFunction(Session, *BuiltinFunction, Type, ParameterTypes),
+                                               ArgumentValues);
+        }
+
+        // inline: len, reserve and push
+        auto Int64 = llvm::Type::getInt64Ty(*Session.Context);
+        auto List = ArgumentValues[0];
+        if (Arguments[0]->type == Types.String)
+            return CreateStringLength(Session, List);    // len is the only builtin on strings
+        if (Callee.str() == "len")
+            return LoadListField(Session, List, 0, "length");
+
+        auto Reserve = GetRuntimeFunction(Session, "t_list_reserve", llvm::Type::getVoidTy(*Session.Context),
+                                          {List->getType(), Int64});
+        if (Callee.str() == "reserve")
+            return Session.Builder->CreateCall(Reserve, {List, ArgumentValues[1]});
+
+        // push
+        auto Element = ArgumentValues[1];
+        auto Function = Session.Builder->GetInsertBlock()->getParent();
+        auto Length = LoadListField(Session, List, 0, "length");
+        auto Capacity = LoadListField(Session, List, 1, "capacity");
+        auto NewLength = Session.Builder->CreateAdd(Length, ConstantInt::get(Int64, 1), "new_length");
+        auto Full = Session.Builder->CreateICmpUGE(Length, Capacity, "full");
+        auto GrowBlock = BasicBlock::Create(*Session.Context, "grow", Function);
+        auto ContinueBlock = BasicBlock::Create(*Session.Context, "continue", Function);
+        Session.Builder->CreateCondBr(Full, GrowBlock, ContinueBlock,
+                                      MDBuilder(*Session.Context).createBranchWeights(1, 1 << 20));
+
+        Session.Builder->SetInsertPoint(GrowBlock);
+        Session.Builder->CreateCall(Reserve, {List, NewLength});
+        Session.Builder->CreateBr(ContinueBlock);
+
+        Session.Builder->SetInsertPoint(ContinueBlock);
+        auto Elements = GetListElements(Session, List, Element->getType());
+        auto Address = Session.Builder->CreateGEP(Element->getType(), Elements, Length);
+        TagListAccess(Session, Session.Builder->CreateStore(Element, Address), false);
+        auto LengthAddress = Session.Builder->CreateStructGEP(GetListHeaderType(*Session.Context), List, 0);
+        return TagListAccess(Session, Session.Builder->CreateStore(NewLength, LengthAddress), true);
     }
 
-    Value *Call::codegen() {
-        llvm::Function *function = Module->getFunction(Callee);
+    Value *Call::codegen(CompilationSession &Session) {
+        if (BuiltinFunction) {
+            auto Result = codegenBuiltin(Session);
+            if (Result && IntegerResult && type != IntegerResult)
+                return Session.Builder->CreateSIToFP(Result, type->GetLLVMType(Session));
+            return Result;
+        }
+        llvm::Function *function = Session.Module->getFunction(Callee.str());
         if (!function)
             return LogError(location, "Function not defined!");
         if (function->arg_size() != Arguments.size())
             return LogError(location,
                             "Number of Arguments given does not match the number of arguments of the function.");
         vector<Value *> ArgumentValues = {};
-        for (int i = 0; i < Arguments.size(); i++) {
-            auto value = Arguments[i]->codegen();
+        for (size_t i = 0; i < Arguments.size(); i++) {
+            auto value = Arguments[i]->codegen(Session);
             if (!value)
                 return nullptr;
             ArgumentValues.push_back(value);
         }
-        return Builder->CreateCall(function, ArgumentValues);
+        auto Result = Session.Builder->CreateCall(function, ArgumentValues);
+        // Only extern functions are declarations; the strings they return have no length in front
+        if (type == Types.String && function->isDeclaration()) {
+            auto FromC = GetRuntimeFunction(Session, "t_string_from_c", Result->getType(), {Result->getType()});
+            return Session.Builder->CreateCall(FromC, {Result});
+        }
+        return Result;
     }
 
-    Value *BinaryExpression::codegen() {
-        if (Op == "=") {
-            auto AddressAndType = LHS->getAddressAndType();
+    Value *BinaryExpression::codegen(CompilationSession &Session) {
+        if (Op == punctuator('=')) {
+            auto AddressAndType = LHS->getAddressAndType(Session);
 
-            auto Value = RHS->codegen();
+            auto Value = RHS->codegen(Session);
             if (!Value)
                 return nullptr;
 
-            Builder->CreateStore(Value, AddressAndType.first);
+            auto Store = Session.Builder->CreateStore(Value, AddressAndType.first);
+            if (LHS->getNodeType() == NodeType::INDEXING && ((Indexing *) LHS)->isListElement())
+                TagListAccess(Session, Store, false);
             return Value;
         }
 
-        auto L = LHS->codegen();
-        auto R = RHS->codegen();
-
-        if (LHS->type->type == "string" && RHS->type->type == "string") {
-            if (Op == "=="){
-                // FIXME: Make this independent from the string.t file
-                if (auto Function = Module->getFunction("isEqual"))
-                    return Builder->CreateCall(Function, {L, R});
-                else {
-                    LogError(location, "Function isEqual not defined! You might have to include the string.t file.");
-                    exit(1);
-                }
-            }
-            else{
-                LogError(location, "Operator not supported for strings!");
-                exit(1);
-            }
-        } else if (LHS->type->type == "number" && RHS->type->type == "number") {
+        auto L = LHS->codegen(Session);
+        auto R = RHS->codegen(Session);
+
+        if (LHS->type == Types.String && RHS->type == Types.String) {
+            if (!L || !R)
+                return nullptr;
+            // the operators call the builtins concat, isEqual and compare
+            static const Builtin *Concat = GetBuiltin(InternedString::get("concat")),
+                                 *Equal = GetBuiltin(InternedString::get("isEqual")),
+                                 *Compare = GetBuiltin(InternedString::get("compare"));
+            auto StringType = L->getType();
+            if (Op == punctuator('+'))
+                return Session.Builder->CreateCall(
+                        GetBuiltinFunction(Session, *Concat, StringType, {StringType, StringType}), {L, R});
+            if (Op == punctuator('=', '='))
+                return Session.Builder->CreateCall(GetBuiltinFunction(Session, *Equal, Types.Bool->GetLLVMType(Session),
+                                                                      {StringType, StringType}), {L, R});
+            auto Int32 = llvm::Type::getInt32Ty(*Session.Context);
+            auto Order = Session.Builder->CreateCall(
+                    GetBuiltinFunction(Session, *Compare, Int32, {StringType, StringType}), {L, R});
+            auto Zero = ConstantInt::get(Int32, 0);
+            if (Op == punctuator('<'))
+                return Session.Builder->CreateICmpSLT(Order, Zero);
+            else if (Op == punctuator('>'))
+                return Session.Builder->CreateICmpSGT(Order, Zero);
+            else if (Op == punctuator('>', '='))
+                return Session.Builder->CreateICmpSGE(Order, Zero);
+            else if (Op == punctuator('<', '='))
+                return Session.Builder->CreateICmpSLE(Order, Zero);
+            LogError(location, "Operator not supported for strings!");
+            StopCompilation();
+        } else if (LHS->type == RHS->type && LHS->type->isInteger()) {
+            if (!L || !R)
+                return nullptr;
+            bool Unsigned = LHS->type->isUnsigned();
+            if (Op == punctuator('+'))
+                return Session.Builder->CreateAdd(L, R);
+            else if (Op == punctuator('-'))
+                return Session.Builder->CreateSub(L, R);
+            else if (Op == punctuator('*'))
+                return Session.Builder->CreateMul(L, R);
+            else if (Op == punctuator('/'))
+                return Unsigned ? Session.Builder->CreateUDiv(L, R) : Session.Builder->CreateSDiv(L, R);
+            else if (Op == punctuator('<'))
+                return Unsigned ? Session.Builder->CreateICmpULT(L, R) : Session.Builder->CreateICmpSLT(L, R);
+            else if (Op == punctuator('>'))
+                return Unsigned ? Session.Builder->CreateICmpUGT(L, R) : Session.Builder->CreateICmpSGT(L, R);
+            else if (Op == punctuator('>', '='))
+                return Unsigned ? Session.Builder->CreateICmpUGE(L, R) : Session.Builder->CreateICmpSGE(L, R);
+            else if (Op == punctuator('<', '='))
+                return Unsigned ? Session.Builder->CreateICmpULE(L, R) : Session.Builder->CreateICmpSLE(L, R);
+            else if (Op == punctuator('=', '='))
+                return Session.Builder->CreateICmpEQ(L, R);
+            else
+                return LogError(location, "Unrecognized Operator.");
+        } else if (LHS->type == RHS->type && LHS->type->isFloatingPoint()) {
             if (!L || !R)
                 return nullptr;
-            if (Op == "+")
-                return Builder->CreateFAdd(L, R);
-            else if (Op == "-")
-                return Builder->CreateFSub(L, R);
-            else if (Op == "*")
-                return Builder->CreateFMul(L, R);
-            else if (Op == "/")
-                return Builder->CreateFDiv(L, R);
-            else if (Op == "<")
-                return Builder->CreateFCmpULT(L, R);
-            else if (Op == ">")
-                return Builder->CreateFCmpUGT(L, R);
-            else if (Op == ">=")
-                return Builder->CreateFCmpUGE(L, R);
-            else if (Op == "<=")
-                return Builder->CreateFCmpULE(L, R);
-            else if (Op == "==")
-                return Builder->CreateFCmpOEQ(L, R);
+            if (Op == punctuator('+'))
+                return Session.Builder->CreateFAdd(L, R);
+            else if (Op == punctuator('-'))
+                return Session.Builder->CreateFSub(L, R);
+            else if (Op == punctuator('*'))
+                return Session.Builder->CreateFMul(L, R);
+            else if (Op == punctuator('/'))
+                return Session.Builder->CreateFDiv(L, R);
+            else if (Op == punctuator('<'))
+                return Session.Builder->CreateFCmpULT(L, R);
+            else if (Op == punctuator('>'))
+                return Session.Builder->CreateFCmpUGT(L, R);
+            else if (Op == punctuator('>', '='))
+                return Session.Builder->CreateFCmpUGE(L, R);
+            else if (Op == punctuator('<', '='))
+                return Session.Builder->CreateFCmpULE(L, R);
+            else if (Op == punctuator('=', '='))
+                return Session.Builder->CreateFCmpOEQ(L, R);
             else
                 return LogError(location, "Unrecognized Operator.");
         }
         else{
             LogError(location, "Incompatible operator types.");
-            exit(1);
+            StopCompilation();
         }
 
     }
 
-    Value *Return::codegen() {
-        auto ExpressionValue = Value->codegen();
+    Value *BinaryExpression::codegenIntegerComparison(CompilationSession &Session, InternedString VariableName,
+                                                      llvm::Value *IntegerValue) {
+        if (LHS->getNodeType() != NodeType::VARIABLE || ((Variable *) LHS)->Name != VariableName ||
+            RHS->type != Types.Number)
+            return nullptr;
+        // the integer a len() bound is converted from needs no rounding
+        auto *IntegerCall = RHS->getNodeType() == NodeType::CALL && ((Call *) RHS)->getIntegerResult() ? (Call *) RHS
+                                                                                                          : nullptr;
+        // For an integer i: i < b is i < ceil(b), i <= b is i <= floor(b), i > b is i > floor(b), i >= b is i >= ceil(b)
+        bool RoundUp;
+        CmpInst::Predicate Predicate;
+        if (Op == punctuator('<'))
+            RoundUp = true, Predicate = CmpInst::ICMP_SLT;
+        else if (Op == punctuator('<', '='))
+            RoundUp = false, Predicate = CmpInst::ICMP_SLE;
+        else if (Op == punctuator('>'))
+            RoundUp = false, Predicate = CmpInst::ICMP_SGT;
+        else if (Op == punctuator('>', '='))
+            RoundUp = true, Predicate = CmpInst::ICMP_SGE;
+        else
+            return nullptr;
+
+        auto Bound = IntegerCall ? IntegerCall->codegenBuiltin(Session) : RHS->codegen(Session);
+        if (!Bound)
+            return nullptr;
+        auto IntegerType = IntegerValue->getType();
+        Value *IntegerBound;
+        if (IntegerCall)
+            IntegerBound = Session.Builder->CreateSExtOrTrunc(Bound, IntegerType);
+        else if (auto *Constant = dyn_cast<ConstantFP>(Bound)) {
+            double Rounded = RoundUp ? ceil(Constant->getValueAPF().convertToDouble())
+                                     : floor(Constant->getValueAPF().convertToDouble());
+            // same saturation as llvm.fptosi.sat
+            int64_t Saturated = isnan(Rounded) ? 0 : Rounded >= 0x1p63 ? INT64_MAX : Rounded < -0x1p63 ? INT64_MIN
+                                                                                            : (int64_t) Rounded;
+            IntegerBound = ConstantInt::get(IntegerType, Saturated, true);
+        } else {
+            auto Rounded = Session.Builder->CreateUnaryIntrinsic(RoundUp ? Intrinsic::ceil : Intrinsic::floor, Bound);
+            IntegerBound = Session.Builder->CreateIntrinsic(Intrinsic::fptosi_sat, {IntegerType, Bound->getType()},
+                                                            {Rounded});
+        }
+        return Session.Builder->CreateICmp(Predicate, IntegerValue, IntegerBound, "condition");
+    }
+
+    Value *Return::codegen(CompilationSession &Session) {
+        auto ExpressionValue = Value->codegen(Session);
         if (!ExpressionValue)
             return nullptr;
-        return Builder->CreateRet(ExpressionValue);
+        if (!Session.RegionMarks.empty())
+            CreateRegionLeave(Session, Session.RegionMarks.front());
+        return Session.Builder->CreateRet(ExpressionValue);
     }
 
-    Value *IfStatement::codegen() {
-        auto ConditionValue = Condition->codegen();
+    Value *IfStatement::codegen(CompilationSession &Session) {
+        auto ConditionValue = Condition->codegen(Session);
         if (!ConditionValue)
             return nullptr;
-        if (ConditionValue->getType() != llvm::Type::getInt1Ty(*Context))
-            ConditionValue = Builder->CreateFCmpONE(ConditionValue,
-                                                    ConstantFP::get(*Context, APFloat(0.0)));
+        ConditionValue = CreateCondition(Session, ConditionValue);
 
-        auto Function = Builder->GetInsertBlock()->getParent();
+        auto Function = Session.Builder->GetInsertBlock()->getParent();
 
-        auto ThenBlock = BasicBlock::Create(*Context, "then", Function);
-        auto ElseBlock = BasicBlock::Create(*Context, "else");
-        auto After = BasicBlock::Create(*Context, "continue");
+        auto ThenBlock = BasicBlock::Create(*Session.Context, "then", Function);
+        auto ElseBlock = BasicBlock::Create(*Session.Context, "else");
+        auto After = BasicBlock::Create(*Session.Context, "continue");
 
         BranchInst *conditionInstruction;
-        conditionInstruction = Builder->CreateCondBr(ConditionValue, ThenBlock, ElseBlock);
+        conditionInstruction = Session.Builder->CreateCondBr(ConditionValue, ThenBlock, ElseBlock);
 
-        Builder->SetInsertPoint(ThenBlock);
-        Symbols.CreateScope();
+        Session.Builder->SetInsertPoint(ThenBlock);
+        Session.Symbols.CreateScope();
         for (auto &Expression: Then) {
-            auto ExpressionIR = Expression->codegen();
+            auto ExpressionIR = Expression->codegen(Session);
 
             if (!ExpressionIR)
                 return nullptr;
         }
-        if (Builder->GetInsertBlock()->getTerminator() == nullptr)
-            Builder->CreateBr(After);
-        Symbols.DestroyScope();
+        if (Session.Builder->GetInsertBlock()->getTerminator() == nullptr)
+            Session.Builder->CreateBr(After);
+        Session.Symbols.DestroyScope();
 
         Function->getBasicBlockList().push_back(ElseBlock);
-        Builder->SetInsertPoint(ElseBlock);
-        Symbols.CreateScope();
+        Session.Builder->SetInsertPoint(ElseBlock);
+        Session.Symbols.CreateScope();
         for (auto &Expression: Else) {
-            auto ExpressionIR = Expression->codegen();
+            auto ExpressionIR = Expression->codegen(Session);
 
             if (!ExpressionIR)
                 return nullptr;
         }
-        if (Builder->GetInsertBlock()->getTerminator() == nullptr)
-            Builder->CreateBr(After);
-        Symbols.DestroyScope();
+        if (Session.Builder->GetInsertBlock()->getTerminator() == nullptr)
+            Session.Builder->CreateBr(After);
+        Session.Symbols.DestroyScope();
 
         Function->getBasicBlockList().push_back(After);
-        Builder->SetInsertPoint(After);
+        Session.Builder->SetInsertPoint(After);
         return conditionInstruction;
     }
 
-    Value *ForLoop::codegen() {
-        auto Function = Builder->GetInsertBlock()->getParent();
-        auto ForLoopBlock = BasicBlock::Create(*Context, "loop", Function);
+    // Whether Condition compares the integer induction variable with a bound that the constant Step moves it towards.
+    // Such a loop terminates: the variable either reaches the bound or overflows, which nsw makes undefined.
+    bool StepsTowardsBound(Value *Condition, AllocaInst *Induction, Value *Step) {
+        auto Comparison = dyn_cast<ICmpInst>(Condition);
+        auto StepConstant = dyn_cast<ConstantInt>(Step);
+        if (!Comparison || !StepConstant || StepConstant->isZero())
+            return false;
+        auto Current = dyn_cast<LoadInst>(Comparison->getOperand(0));
+        if (!Current || Current->getPointerOperand() != Induction)
+            return false;
+        switch (Comparison->getPredicate()) {
+            case CmpInst::ICMP_SLT:
+            case CmpInst::ICMP_SLE:
+                return !StepConstant->isNegative();
+            case CmpInst::ICMP_SGT:
+            case CmpInst::ICMP_SGE:
+                return StepConstant->isNegative();
+            default:
+                return false;
+        }
+    }
+
+    Value *ForLoop::codegen(CompilationSession &Session) {
+        auto Function = Session.Builder->GetInsertBlock()->getParent();
 
-        auto StartValue = Start->codegen();
+        auto StartValue = Start->codegen(Session);
         if (!StartValue)
             return nullptr;
 
-        Symbols.CreateScope();
-        auto Alloca = CreateAlloca(Function, llvm::Type::getDoubleTy(*Context), VariableName);
-        Symbols.CreateVariable(VariableName, make_shared<Type>("number"), Alloca);
-        Builder->CreateStore(StartValue, Alloca);
-
-        Builder->CreateBr(ForLoopBlock);
-        Builder->SetInsertPoint(ForLoopBlock);
-
+        // Counted loops step an integer induction variable and only store its number value for the body to read
+        auto InductionType = Counted ? Types.Int64 : VariableType;
+        Session.Symbols.CreateScope();
+        auto Induction = CreateAlloca(Session, Function, InductionType->GetLLVMType(Session), VariableName.str());
+        auto Alloca = Counted ? CreateAlloca(Session, Function, VariableType->GetLLVMType(Session), VariableName.str())
+                              : Induction;
+        Session.Symbols.CreateVariable(VariableName, VariableType, Alloca);
+        Session.Builder->CreateStore(StartValue, Induction);
+
+        // Guarded loop: preheader -> body -> latch -> body | exit, with the condition also checked before entering
+        auto Guard = codegenCondition(Session, Induction, Alloca);
+        if (!Guard)
+            return nullptr;
+        auto PreheaderBlock = BasicBlock::Create(*Session.Context, "for.preheader", Function);
+        auto BodyBlock = BasicBlock::Create(*Session.Context, "for.body", Function);
+        auto LatchBlock = BasicBlock::Create(*Session.Context, "for.latch");
+        auto ExitBlock = BasicBlock::Create(*Session.Context, "for.exit");
+        Session.Builder->CreateCondBr(Guard, PreheaderBlock, ExitBlock);
+
+        Session.Builder->SetInsertPoint(PreheaderBlock);
+        Session.Builder->CreateBr(BodyBlock);
+
+        Session.Builder->SetInsertPoint(BodyBlock);
+        if (Region)
+            EnterRegion(Session);
         for (auto &Expression: Body) {
-            auto ExpressionIR = Expression->codegen();
+            auto ExpressionIR = Expression->codegen(Session);
             if (!ExpressionIR)
                 return nullptr;
         }
+        if (Region)
+            LeaveRegion(Session);
+        if (Session.Builder->GetInsertBlock()->getTerminator() == nullptr)
+            Session.Builder->CreateBr(LatchBlock);
 
+        Function->getBasicBlockList().push_back(LatchBlock);
+        Session.Builder->SetInsertPoint(LatchBlock);
         Value *StepValue;
         if (Step) {
-            StepValue = Step->codegen();
+            StepValue = Step->codegen(Session);
             if (!StepValue)
                 return nullptr;
         } else {
-            StepValue = ConstantFP::get(*Context, APFloat(1.0));
+            StepValue = InductionType->isInteger() ? ConstantInt::get(InductionType->GetLLVMType(Session), 1)
+                                                   : ConstantFP::get(InductionType->GetLLVMType(Session), 1.0);
         }
-        auto CurrentStep = Builder->CreateLoad(Alloca->getAllocatedType(), Alloca, VariableName);
-        auto NextStep = Builder->CreateFAdd(CurrentStep, StepValue, "step");
-        Builder->CreateStore(NextStep, Alloca);
+        auto CurrentStep = Session.Builder->CreateLoad(Induction->getAllocatedType(), Induction, VariableName.str());
+        auto NextStep = InductionType->isInteger() ? Session.Builder->CreateNSWAdd(CurrentStep, StepValue, "step")
+                                                   : Session.Builder->CreateFAdd(CurrentStep, StepValue, "step");
+        Session.Builder->CreateStore(NextStep, Induction);
 
-        Value *EndCondition = Condition->codegen();
+        auto EndCondition = codegenCondition(Session, Induction, Alloca);
         if (!EndCondition)
             return nullptr;
+        auto Backedge = Session.Builder->CreateCondBr(EndCondition, BodyBlock, ExitBlock);
+        if (Counted && StepsTowardsBound(EndCondition, Induction, StepValue)) {
+            // The loop terminates, which lets LLVM delete it when its result is unused
+            auto &Context = *Session.Context;
+            auto MustProgress = MDNode::get(Context, MDString::get(Context, "llvm.loop.mustprogress"));
+            auto LoopID = MDNode::getDistinct(*Session.Context, {nullptr, MustProgress});
+            LoopID->replaceOperandWith(0, LoopID);
+            Backedge->setMetadata(LLVMContext::MD_loop, LoopID);
+        }
+        Session.Symbols.DestroyScope();
 
-        if (EndCondition->getType() != llvm::Type::getInt1Ty(*Context))
-            EndCondition = Builder->CreateFCmpONE(
-                    EndCondition, ConstantFP::get(*Context, APFloat(0.0)), "conditon");
+        Function->getBasicBlockList().push_back(ExitBlock);
+        Session.Builder->SetInsertPoint(ExitBlock);
+        return Constant::getNullValue(llvm::Type::getDoubleTy(*Session.Context));
+    }
 
-        auto AfterBlock = BasicBlock::Create(*Context, "afterloop", Function);
-        Builder->CreateCondBr(EndCondition, ForLoopBlock, AfterBlock);
-        Symbols.DestroyScope();
-        Builder->SetInsertPoint(AfterBlock);
-        return Constant::getNullValue(llvm::Type::getDoubleTy(*Context));
+    Value *ForLoop::codegenCondition(CompilationSession &Session, AllocaInst *Induction, AllocaInst *Variable) {
+        if (Induction != Variable) {
+            auto Current = Session.Builder->CreateLoad(Induction->getAllocatedType(), Induction, VariableName.str());
+            auto Converted = Session.Builder->CreateSIToFP(Current, Variable->getAllocatedType());
+            Session.Builder->CreateStore(Converted, Variable);
+            if (Condition->getNodeType() == NodeType::BINARY_EXPRESSION) {
+                auto Comparison = ((BinaryExpression *) Condition)->codegenIntegerComparison(Session, VariableName,
+                                                                                             Current);
+                if (Comparison)
+                    return Comparison;
+            }
+        }
+        auto ConditionValue = Condition->codegen(Session);
+        if (!ConditionValue)
+            return nullptr;
+        return CreateCondition(Session, ConditionValue);
     }
 
-    Value *WhileLoop::codegen() {
-        auto Function = Builder->GetInsertBlock()->getParent();
-        auto WhileLoopBlock = BasicBlock::Create(*Context, "whileloop", Function);
-        auto AfterBlock = BasicBlock::Create(*Context, "afterloop", Function);
-        Value *ConditionValue = Condition->codegen();
+    Value *WhileLoop::codegen(CompilationSession &Session) {
+        auto Function = Session.Builder->GetInsertBlock()->getParent();
+        auto WhileLoopBlock = BasicBlock::Create(*Session.Context, "whileloop", Function);
+        auto AfterBlock = BasicBlock::Create(*Session.Context, "afterloop", Function);
+        Value *ConditionValue = Condition->codegen(Session);
         if (!ConditionValue)
             return nullptr;
 
-        ConditionValue = Builder->CreateFCmpONE(ConditionValue, ConstantFP::get(*Context, APFloat(0.0)),
-                                                "condition");
+        ConditionValue = CreateCondition(Session, ConditionValue);
 
-        Builder->CreateCondBr(ConditionValue, WhileLoopBlock, AfterBlock);
-        Builder->SetInsertPoint(WhileLoopBlock);
-        Symbols.CreateScope();
+        Session.Builder->CreateCondBr(ConditionValue, WhileLoopBlock, AfterBlock);
+        Session.Builder->SetInsertPoint(WhileLoopBlock);
+        Session.Symbols.CreateScope();
+        if (Region)
+            EnterRegion(Session);
 
         for (auto &Expression: Body) {
-            auto ExpressionIR = Expression->codegen();
+            auto ExpressionIR = Expression->codegen(Session);
             if (!ExpressionIR)
                 return nullptr;
         }
+        if (Region)
+            LeaveRegion(Session);
 
-        ConditionValue = Condition->codegen();
+        ConditionValue = Condition->codegen(Session);
         if (!ConditionValue)
             return nullptr;
 
-        if (ConditionValue->getType() != llvm::Type::getInt1Ty(*Context))
-            ConditionValue = Builder->CreateFCmpONE(ConditionValue, ConstantFP::get(*Context, APFloat(0.0)),
-                                                    "condition");
+        ConditionValue = CreateCondition(Session, ConditionValue);
 
-        Builder->CreateCondBr(ConditionValue, WhileLoopBlock, AfterBlock);
-        Symbols.DestroyScope();
+        Session.Builder->CreateCondBr(ConditionValue, WhileLoopBlock, AfterBlock);
+        Session.Symbols.DestroyScope();
 
-        Builder->SetInsertPoint(AfterBlock);
+        Session.Builder->SetInsertPoint(AfterBlock);
 
-        return Constant::getNullValue(llvm::Type::getDoubleTy(*Context));
+        return Constant::getNullValue(llvm::Type::getDoubleTy(*Session.Context));
     }
 
-    Value *Function::codegen() {
-        llvm::Function *Function = Module->getFunction(Name);
+    Value *Function::codegen(CompilationSession &Session) {
+        llvm::Function *Function = Session.Module->getFunction(Name.str());
         if (!Function) {
             // Create Vector that specifies the types for the arguments (atm only floating point numbers aka doubles)
             vector<llvm::Type *> ArgumentTypes(Arguments.size());
-            for (int i = 0; i < Arguments.size(); i++) {
-                ArgumentTypes[i] = Arguments[i].first->GetLLVMType();
+            for (size_t i = 0; i < Arguments.size(); i++) {
+                ArgumentTypes[i] = Arguments[i].first->GetLLVMType(Session);
             }
-            FunctionType *FunctionType = FunctionType::get(type->GetLLVMType(), ArgumentTypes, false);
-            Function = llvm::Function::Create(FunctionType, llvm::Function::ExternalLinkage, Name, Module.get());
+            FunctionType *FunctionType = FunctionType::get(type->GetLLVMType(Session), ArgumentTypes, false);
+            // only main is called from outside the module, everything else can be inlined and removed when unused
+            auto Linkage = Name.str() == "main" ? llvm::Function::ExternalLinkage : llvm::Function::InternalLinkage;
+            Function = llvm::Function::Create(FunctionType, Linkage, Name.str(), Session.Module.get());
             int i = 0;
             for (auto &Argument: Function->args()) {
-                Argument.setName(Arguments[i].second);
+                Argument.setName(Arguments[i].second.str());
                 i += 1;
             }
         }
+        // t has no exceptions
+        Function->setDoesNotThrow();
+        if (ReadNone)
+            Function->setDoesNotAccessMemory();
+        if (WillReturn)
+            Function->addFnAttr(Attribute::WillReturn);
 
         if (!Function->empty())
             return LogError(location, "Can't redefine Function");
 
         //Define BasicBlock to start inserting into for function
-        BasicBlock *BasicBlock = BasicBlock::Create(*Context, "entry", Function);
-        Builder->SetInsertPoint(BasicBlock);
+        BasicBlock *BasicBlock = BasicBlock::Create(*Session.Context, "entry", Function);
+        Session.Builder->SetInsertPoint(BasicBlock);
 
-        Symbols.CreateScope();
+        Session.Symbols.CreateScope();
         int argument = 0;
         for (auto &Arg: Function->args()) {
-            Arg.setName(Arguments[argument].second);
-            AllocaInst *Alloca = CreateAlloca(Function, Arguments[argument].first->GetLLVMType(),
+            Arg.setName(Arguments[argument].second.str());
+            AllocaInst *Alloca = CreateAlloca(Session, Function, Arguments[argument].first->GetLLVMType(Session),
                                               Arg.getName().str());
-            Symbols.CreateVariable(Arg.getName().str(), Arguments[argument].first, Alloca);
-            Builder->CreateStore(&Arg, Alloca);
+            Session.Symbols.CreateVariable(Arguments[argument].second, Arguments[argument].first, Alloca);
+            Session.Builder->CreateStore(&Arg, Alloca);
             argument += 1;
         }
-        Symbols.CreateFunction(Name, type, Arguments, Function);
-        for (int i = 0; i < Body.size(); i++) {
-            auto value = Body[i]->codegen();
+        Session.Symbols.CreateFunction(Name, type, Arguments, Function);
+        auto EnclosingRegionMarks = move(Session.RegionMarks);
+        Session.RegionMarks.clear();
+        if (Region)
+            EnterRegion(Session);
+        for (size_t i = 0; i < Body.size(); i++) {
+            auto value = Body[i]->codegen(Session);
 
             if (!value) {
                 Function->eraseFromParent();    // error occurred delete the function
+                Session.RegionMarks = move(EnclosingRegionMarks);
                 return Function;
             }
         }
-        Symbols.DestroyScope();
+        Session.RegionMarks = move(EnclosingRegionMarks);
+        Session.Symbols.DestroyScope();
         return Function;
     }
 
-    Value *Extern::codegen() {
-        llvm::Function *Function = Module->getFunction(Name);
+    Value *Extern::codegen(CompilationSession &Session) {
+        llvm::Function *Function = Session.Module->getFunction(Name.str());
         if (!Function) {
-            vector<llvm::Type *> ArgumentTypes(Arguments.size(), llvm::Type::getDoubleTy(*Context));
-            for (int i = 0; i < Arguments.size(); i++) {
-                ArgumentTypes[i] = Arguments[i].first->GetLLVMType();
+            vector<llvm::Type *> ArgumentTypes(Arguments.size(), llvm::Type::getDoubleTy(*Session.Context));
+            for (size_t i = 0; i < Arguments.size(); i++) {
+                ArgumentTypes[i] = Arguments[i].first->GetLLVMType(Session);
             }
-            FunctionType *FunctionType = FunctionType::get(type->GetLLVMType(), ArgumentTypes, false);
-            Function = llvm::Function::Create(FunctionType, llvm::Function::ExternalLinkage, Name, Module.get());
+            FunctionType *FunctionType = FunctionType::get(type->GetLLVMType(Session), ArgumentTypes, false);
+            Function = llvm::Function::Create(FunctionType, llvm::Function::ExternalLinkage, Name.str(),
+                                              Session.Module.get());
             int i = 0;
             for (auto &Argument: Function->args()) {
-                Argument.setName(Arguments[i].second);
+                Argument.setName(Arguments[i].second.str());
                 i += 1;
             }
+            AddIntegerExtensions(Function);
         }
-        Symbols.CreateFunction(Name, type, Arguments, Function);
+        Session.Symbols.CreateFunction(Name, type, Arguments, Function);
         return Function;
     }
 
-    Value *Assembly::codegen() {
+    Value *Assembly::codegen(CompilationSession &) {
         assert(false && "Assembly not implemented yet");
         return nullptr;
     }
 
-    llvm::Value *Structure::codegen() {
-        vector<llvm::Type *> Types;
+    llvm::Value *Structure::codegen(CompilationSession &Session) {
+        vector<llvm::Type *> MemberTypes;
         for (auto &Member: Members) {
-            auto Type = Member.second->GetLLVMType();
-            Types.push_back(Type);
+            auto Type = Member.second->GetLLVMType(Session);
+            MemberTypes.push_back(Type);
         }
-        auto *StructType = llvm::StructType::create(Types, Name);
-        Symbols.CreateStructure(Name, Members, StructType);
+        auto *StructType = llvm::StructType::create(MemberTypes, Name.str());
+        Session.Symbols.CreateStructure(Name, Members, StructType);
+        Session.LLVMTypes[Types.get(Name)] = StructType;
+        return nullptr;
     }
 
-    Value *Member::codegen() {
-        auto AddressAndType = getAddressAndType();
+    Value *Member::codegen(CompilationSession &Session) {
+        auto AddressAndType = getAddressAndType(Session);
         auto Address = AddressAndType.first;
         auto Type = AddressAndType.second;
-        return Builder->CreateLoad(Type, Address);
+        return Session.Builder->CreateLoad(Type, Address);
     }
 }
\ No newline at end of file
@@ -4,7 +4,11 @@
 
 #pragma once
 
+#include <set>
+#include <unordered_map>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include "arena.h"
 #include "symbols.h"
 
 using namespace std;
@@ -12,10 +16,80 @@ using namespace llvm;
 
 namespace t {
 
-    extern unique_ptr<LLVMContext> Context;
-    extern unique_ptr<IRBuilder<>> Builder;
-    extern unique_ptr<Module> Module;
-    extern Symbols Symbols;
+    class ObjectFileCache;
 
-    void InitializeLLVM();
-}
\ No newline at end of file
+    // Metadata kind on the conditional branch of every bounds check; the true successor is the in-range path
+    constexpr const char *BoundsCheckMetadata = "t.bounds_check";
+
+    // What the function being checked might do. Functions that only compute with their arguments and locals are
+    // readnone, and those without loops, recursion and calls to functions that might not return are willreturn.
+    struct FunctionEffects {
+        InternedString Name;
+        bool AccessesMemory = false;
+        bool MightNotReturn = false;
+    };
+
+    // Loops and functions can get a region of their own, which is released when an iteration or call ends. While
+    // checking types, each enclosing RegionScope records whether something in it allocates and whether a heap value
+    // could outlive it: by being assigned to a variable defined outside of it, stored in a list or structure, handed
+    // to a function in a list or returned. Only scopes that allocate and let nothing escape get a region.
+    struct RegionScope {
+        bool *Region;
+        size_t Depth;   // depth of the innermost scope of Symbols that belongs to it
+        bool Allocates = false;
+        bool Escapes = false;
+    };
+
+    // Everything the compilation of one program works on, from its AST to its module. Sessions only share the
+    // interned strings and types, so several of them can compile different programs on different threads.
+    class CompilationSession {
+    public:
+        unique_ptr<LLVMContext> Context;
+        unique_ptr<IRBuilder<>> Builder;
+        unique_ptr<llvm::Module> Module;
+        t::Symbols Symbols;
+
+        // All nodes are made in this arena and freed together once codegen is done
+        Arena NodeArena;
+        vector<Node *> FunctionDeclarations, TopLevelExpressions;
+        vector<Structure *> Structures;
+        set<string> ImportedFiles;
+        // Cache the compiled program is stored in, if any; the parsers add each file they read to it
+        ObjectFileCache *Cache = nullptr;
+        // Tokens read by the parsers, for --time-phases
+        size_t Tokens = 0;
+
+        // Check indices of fixed-size arrays and strings too, not only of lists
+        bool CheckedIndexing = false;
+
+        // LLVM types of the types used in Context, see Type::GetLLVMType
+        unordered_map<const Type *, llvm::Type *> LLVMTypes;
+
+        // Return type of the function currently being checked; top level expressions end up in main, which returns a
+        // number
+        Type *ReturnType = Types.Number;
+        // Effects of the function currently being checked; nullptr for top level expressions
+        FunctionEffects *Effects = nullptr;
+        // Region scopes of the function currently being checked, innermost last
+        vector<RegionScope> RegionScopes;
+
+        // Regions entered in the function being generated, outermost first
+        vector<llvm::Value *> RegionMarks;
+
+        CompilationSession() : Context(make_unique<LLVMContext>()),
+                               Builder(make_unique<IRBuilder<>>(*Context)),
+                               Module(make_unique<llvm::Module>("t", *Context)) {}
+
+        CompilationSession(const CompilationSession &) = delete;
+
+        CompilationSession &operator=(const CompilationSession &) = delete;
+
+        // Frees the AST once the module has been generated
+        void ReleaseNodes() {
+            FunctionDeclarations.clear();
+            TopLevelExpressions.clear();
+            Structures.clear();
+            NodeArena.Reset();
+        }
+    };
+}
@@ -4,27 +4,615 @@
 
 #include "corefn.h"
 #include <iostream>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define T_X86
+#endif
 
 using namespace std;
 
+namespace {
+    int64_t Length(const char *str) {
+        return ((const int64_t *) str)[-1];
+    }
+
+    // The string primitives below come in a portable version and, on x86, an SSE2 version (available on every
+    // x86-64 CPU) and an AVX2 version that is picked at runtime if the CPU supports it.
+#ifdef T_X86
+    bool HasAVX2() {
+        static const bool Supported = __builtin_cpu_supports("avx2");
+        return Supported;
+    }
+#endif
+
+    // Index of the first byte from start on in which a and b differ, or length if there is none
+    int64_t MismatchPortable(const char *a, const char *b, int64_t start, int64_t length) {
+        for (int64_t i = start; i < length; i++)
+            if (a[i] != b[i])
+                return i;
+        return length;
+    }
+
+    // Index of the first c from start on, or length if there is none
+    int64_t FindBytePortable(const char *str, char c, int64_t start, int64_t length) {
+        auto found = (const char *) memchr(str + start, c, length - start);
+        return found ? found - str : length;
+    }
+
+    int64_t CountPortable(const char *str, char c, int64_t start, int64_t length) {
+        int64_t count = 0;
+        for (int64_t i = start; i < length; i++)
+            count += str[i] == c;
+        return count;
+    }
+
+    // Index of needle in haystack from start on, or -1; needles are at least two bytes long
+    int64_t FindPortable(const char *haystack, int64_t start, int64_t length, const char *needle,
+                         int64_t needleLength) {
+        for (int64_t i = start; i + needleLength <= length; i++)
+            if (haystack[i] == needle[0] && memcmp(haystack + i + 1, needle + 1, needleLength - 1) == 0)
+                return i;
+        return -1;
+    }
+
+#ifdef T_X86
+    int64_t MismatchSSE2(const char *a, const char *b, int64_t length) {
+        int64_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            auto x = _mm_loadu_si128((const __m128i *) (a + i));
+            auto y = _mm_loadu_si128((const __m128i *) (b + i));
+            unsigned differ = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xFFFF;
+            if (differ)
+                return i + __builtin_ctz(differ);
+        }
+        return MismatchPortable(a, b, i, length);
+    }
+
+    __attribute__((target("avx2")))
+    int64_t MismatchAVX2(const char *a, const char *b, int64_t length) {
+        int64_t i = 0;
+        for (; i + 32 <= length; i += 32) {
+            auto x = _mm256_loadu_si256((const __m256i *) (a + i));
+            auto y = _mm256_loadu_si256((const __m256i *) (b + i));
+            auto differ = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+            if (differ)
+                return i + __builtin_ctz(differ);
+        }
+        return MismatchPortable(a, b, i, length);
+    }
+
+    int64_t FindByteSSE2(const char *str, char c, int64_t start, int64_t length) {
+        auto pattern = _mm_set1_epi8(c);
+        int64_t i = start;
+        for (; i + 16 <= length; i += 16) {
+            unsigned found = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (str + i)), pattern));
+            if (found)
+                return i + __builtin_ctz(found);
+        }
+        return FindBytePortable(str, c, i, length);
+    }
+
+    __attribute__((target("avx2")))
+    int64_t FindByteAVX2(const char *str, char c, int64_t start, int64_t length) {
+        auto pattern = _mm256_set1_epi8(c);
+        int64_t i = start;
+        for (; i + 32 <= length; i += 32) {
+            auto block = _mm256_loadu_si256((const __m256i *) (str + i));
+            auto found = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern));
+            if (found)
+                return i + __builtin_ctz(found);
+        }
+        return FindBytePortable(str, c, i, length);
+    }
+
+    int64_t CountSSE2(const char *str, char c, int64_t length) {
+        auto pattern = _mm_set1_epi8(c);
+        int64_t count = 0, i = 0;
+        for (; i + 16 <= length; i += 16) {
+            auto block = _mm_loadu_si128((const __m128i *) (str + i));
+            count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern)));
+        }
+        return count + CountPortable(str, c, i, length);
+    }
+
+    __attribute__((target("avx2,popcnt")))
+    int64_t CountAVX2(const char *str, char c, int64_t length) {
+        auto pattern = _mm256_set1_epi8(c);
+        int64_t count = 0, i = 0;
+        for (; i + 32 <= length; i += 32) {
+            auto block = _mm256_loadu_si256((const __m256i *) (str + i));
+            count += __builtin_popcount((uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern)));
+        }
+        return count + CountPortable(str, c, i, length);
+    }
+
+    // Candidates are positions whose first and last byte match those of the needle, tested a block at a time;
+    // only they are compared in full.
+    int64_t FindSSE2(const char *haystack, int64_t length, const char *needle, int64_t needleLength) {
+        auto first = _mm_set1_epi8(needle[0]);
+        auto last = _mm_set1_epi8(needle[needleLength - 1]);
+        int64_t i = 0;
+        for (; i + needleLength - 1 + 16 <= length; i += 16) {
+            auto blockFirst = _mm_loadu_si128((const __m128i *) (haystack + i));
+            auto blockLast = _mm_loadu_si128((const __m128i *) (haystack + i + needleLength - 1));
+            unsigned candidates = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first),
+                                                                  _mm_cmpeq_epi8(blockLast, last)));
+            for (; candidates; candidates &= candidates - 1) {
+                int64_t position = i + __builtin_ctz(candidates);
+                if (memcmp(haystack + position + 1, needle + 1, needleLength - 2) == 0)
+                    return position;
+            }
+        }
+        return FindPortable(haystack, i, length, needle, needleLength);
+    }
+
+    __attribute__((target("avx2")))
+    int64_t FindAVX2(const char *haystack, int64_t length, const char *needle, int64_t needleLength) {
+        auto first = _mm256_set1_epi8(needle[0]);
+        auto last = _mm256_set1_epi8(needle[needleLength - 1]);
+        int64_t i = 0;
+        for (; i + needleLength - 1 + 32 <= length; i += 32) {
+            auto blockFirst = _mm256_loadu_si256((const __m256i *) (haystack + i));
+            auto blockLast = _mm256_loadu_si256((const __m256i *) (haystack + i + needleLength - 1));
+            auto candidates = (uint32_t) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first),
+                                                                               _mm256_cmpeq_epi8(blockLast, last)));
+            for (; candidates; candidates &= candidates - 1) {
+                int64_t position = i + __builtin_ctz(candidates);
+                if (memcmp(haystack + position + 1, needle + 1, needleLength - 2) == 0)
+                    return position;
+            }
+        }
+        return FindPortable(haystack, i, length, needle, needleLength);
+    }
+#endif
+
+    int64_t Mismatch(const char *a, const char *b, int64_t length) {
+#ifdef T_X86
+        return HasAVX2() ? MismatchAVX2(a, b, length) : MismatchSSE2(a, b, length);
+#else
+        return MismatchPortable(a, b, 0, length);
+#endif
+    }
+
+    int64_t FindByte(const char *str, char c, int64_t start, int64_t length) {
+#ifdef T_X86
+        return HasAVX2() ? FindByteAVX2(str, c, start, length) : FindByteSSE2(str, c, start, length);
+#else
+        return FindBytePortable(str, c, start, length);
+#endif
+    }
+}
+
+namespace {
+    // A region hands out memory by bumping a pointer through blocks. Leaving a region returns its blocks to a pool,
+    // so a loop that enters and leaves a region in every iteration keeps reusing the same memory.
+    struct Region {
+        vector<pair<char *, size_t>> blocks;
+        char *next = nullptr;
+        char *end = nullptr;
+    };
+
+    constexpr size_t BlockSize = 1 << 16;
+
+    // Regions[0] is the global region, which is never left. Regions past Depth have been left and are kept so their
+    // vectors can be reused.
+    vector<Region> Regions(1);
+    size_t Depth = 1;
+    vector<char *> FreeBlocks;
+
+    char *AllocateBlock(size_t size) {
+        if (size == BlockSize && !FreeBlocks.empty()) {
+            auto block = FreeBlocks.back();
+            FreeBlocks.pop_back();
+            return block;
+        }
+        auto block = (char *) malloc(size);
+        if (!block) {
+            cerr << "Out of memory allocating " << size << " bytes" << endl;
+            exit(1);
+        }
+        return block;
+    }
+
+    char *Allocate(int64_t index, size_t size) {
+        auto &region = Regions[index];
+        size = (size + 7) & ~(size_t) 7;
+        if ((size_t) (region.end - region.next) >= size) {
+            auto memory = region.next;
+            region.next += size;
+            return memory;
+        }
+        // large allocations get a block of their own and leave the current block to smaller ones
+        auto blockSize = max(size, BlockSize);
+        auto block = AllocateBlock(blockSize);
+        region.blocks.emplace_back(block, blockSize);
+        if (blockSize == BlockSize) {
+            region.next = block + size;
+            region.end = block + blockSize;
+        }
+        return block;
+    }
+
+    // Grows an allocation, in place if it is the last one of its block and there is room
+    char *Reallocate(int64_t index, char *memory, size_t size, size_t newSize) {
+        auto &region = Regions[index];
+        size = (size + 7) & ~(size_t) 7;
+        newSize = (newSize + 7) & ~(size_t) 7;
+        if (memory && memory + size == region.next && (size_t) (region.end - memory) >= newSize) {
+            region.next = memory + newSize;
+            return memory;
+        }
+        auto newMemory = Allocate(index, newSize);
+        if (memory)
+            memcpy(newMemory, memory, size);
+        return newMemory;
+    }
+
+    char *AllocateInCurrentRegion(size_t size) {
+        return Allocate(Depth - 1, size);
+    }
+}
+
+extern "C" int64_t t_region_enter(){
+    if (Depth == Regions.size())
+        Regions.emplace_back();
+    return Depth++;
+}
+
+extern "C" void t_region_leave(int64_t region){
+    for (; Depth > (size_t) region; Depth--) {
+        auto &left = Regions[Depth - 1];
+        for (auto &block: left.blocks) {
+            if (block.second == BlockSize)
+                FreeBlocks.push_back(block.first);
+            else
+                free(block.first);
+        }
+        left.blocks.clear();
+        left.next = left.end = nullptr;
+    }
+}
+
+extern "C" char *t_string_new(const char *bytes, int64_t length){
+    auto block = AllocateInCurrentRegion(sizeof(int64_t) + length + 1);
+    *(int64_t *) block = length;
+    auto str = block + sizeof(int64_t);
+    memcpy(str, bytes, length);
+    str[length] = 0;
+    return str;
+}
+
+extern "C" char *t_string_from_c(const char *str){
+    return str ? t_string_new(str, (int64_t) strlen(str)) : t_string_new("", 0);
+}
+
+extern "C" char t_string_equal(const char *str1, const char *str2){
+    int64_t length = Length(str1);
+    return length == Length(str2) && Mismatch(str1, str2, length) == length;
+}
+
+extern "C" int32_t t_string_compare(const char *str1, const char *str2){
+    int64_t length1 = Length(str1), length2 = Length(str2);
+    int64_t common = min(length1, length2);
+    int64_t i = Mismatch(str1, str2, common);
+    if (i < common)
+        return (unsigned char) str1[i] < (unsigned char) str2[i] ? -1 : 1;
+    return length1 < length2 ? -1 : length1 > length2;
+}
+
+extern "C" char *t_string_concat(const char *str1, const char *str2){
+    int64_t length1 = Length(str1), length2 = Length(str2);
+    auto str = t_string_new(str1, length1 + length2);
+    memcpy(str + length1, str2, length2);
+    return str;
+}
+
+extern "C" int64_t t_string_find(const char *haystack, const char *needle){
+    int64_t length = Length(haystack), needleLength = Length(needle);
+    if (needleLength == 0)
+        return 0;
+    if (needleLength > length)
+        return -1;
+    if (needleLength == 1) {
+        int64_t i = FindByte(haystack, needle[0], 0, length);
+        return i < length ? i : -1;
+    }
+#ifdef T_X86
+    if (HasAVX2())
+        return FindAVX2(haystack, length, needle, needleLength);
+    return FindSSE2(haystack, length, needle, needleLength);
+#else
+    return FindPortable(haystack, 0, length, needle, needleLength);
+#endif
+}
+
+extern "C" int64_t t_string_count(const char *str, unsigned char c){
+#ifdef T_X86
+    return HasAVX2() ? CountAVX2(str, c, Length(str)) : CountSSE2(str, c, Length(str));
+#else
+    return CountPortable(str, c, 0, Length(str));
+#endif
+}
+
+extern "C" TList *t_string_split(const char *str, unsigned char separator){
+    auto parts = t_list_new(sizeof(char *));
+    int64_t length = Length(str);
+    for (int64_t start = 0;;) {
+        int64_t end = FindByte(str, separator, start, length);
+        t_list_resize(parts, parts->length + 1, nullptr);
+        ((char **) parts->data)[parts->length - 1] = t_string_new(str + start, end - start);
+        if (end == length)
+            return parts;
+        start = end + 1;
+    }
+}
+
+namespace {
+    // All output goes through this buffer. It is written to stdout when it is full, before input is read, on
+    // flush() and when the program exits.
+    class OutputBuffer {
+        char data[1 << 16];
+        size_t used = 0;
+
+    public:
+        ~OutputBuffer() { Flush(); }
+
+        void Flush() {
+            fwrite(data, 1, used, stdout);
+            fflush(stdout);
+            used = 0;
+        }
+
+        void Write(const char *bytes, size_t length) {
+            if (used + length > sizeof data) {
+                Flush();
+                if (length > sizeof data) {
+                    fwrite(bytes, 1, length, stdout);
+                    return;
+                }
+            }
+            memcpy(data + used, bytes, length);
+            used += length;
+        }
+
+        void Write(char c) {
+            if (used == sizeof data)
+                Flush();
+            data[used++] = c;
+        }
+
+        // Formats like printf's %g, which is what iostreams print by default
+        void Write(double number) {
+            constexpr size_t MaxLength = 32;
+            if (used + MaxLength > sizeof data)
+                Flush();
+            used = to_chars(data + used, data + used + MaxLength, number, chars_format::general, 6).ptr - data;
+        }
+    } Output;
+}
+
+extern "C" void flush(){
+    Output.Flush();
+}
+
 extern "C"  void printString(const char* str){
-    cout << str;
+    Output.Write(str, Length(str));
 }
 
 extern "C" void printAscii(double c){
-    cout << (char)c;
+    Output.Write((char) c);
 }
 
 extern "C" void printNumber(double number){
-    cout << number;
+    Output.Write(number);
+}
+
+extern "C" void printList(TList *numbers, const char *separator){
+    auto values = (double *) numbers->data;
+    for (int64_t i = 0; i < numbers->length; i++) {
+        if (i > 0)
+            Output.Write(separator, Length(separator));
+        Output.Write(values[i]);
+    }
+}
+
+extern "C" void writeBytes(TList *bytes){
+    Output.Write(bytes->data, bytes->length);
+}
+
+namespace {
+    // Reads a file line by line. Regular files are mapped into memory, anything else (pipes, terminals) is read in
+    // chunks. Lines are copied into a buffer laid out like a string, which is reused for the next line.
+    class Reader {
+        int file;
+        const char *mapped = nullptr;
+        size_t mappedSize = 0;
+        size_t position = 0;
+        vector<char> chunk;
+        size_t chunkEnd = 0;
+        vector<char> line;
+
+        // Reads the next chunk, returns false at the end of the file
+        bool Refill() {
+            if (mapped)
+                return false;
+            if (file == STDIN_FILENO)
+                Output.Flush();
+            ssize_t length;
+            do
+                length = read(file, chunk.data(), chunk.size());
+            while (length < 0 && errno == EINTR);
+            position = 0;
+            chunkEnd = max(length, (ssize_t) 0);
+            return chunkEnd > 0;
+        }
+
+    public:
+        explicit Reader(int file) : file(file) {
+            struct stat info;
+            if (fstat(file, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+                auto memory = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+                if (memory != MAP_FAILED) {
+                    madvise(memory, info.st_size, MADV_SEQUENTIAL);
+                    mapped = (const char *) memory;
+                    mappedSize = chunkEnd = info.st_size;
+                }
+            }
+            if (!mapped)
+                chunk.resize(1 << 16);
+        }
+
+        ~Reader() {
+            if (mapped)
+                munmap((void *) mapped, mappedSize);
+            if (file != STDIN_FILENO)
+                close(file);
+        }
+
+        bool HasLine() {
+            return position < chunkEnd || Refill();
+        }
+
+        // The next line without its newline; it stays valid until the next call
+        char *ReadLine() {
+            line.resize(sizeof(int64_t));
+            while (position < chunkEnd || Refill()) {
+                auto bytes = mapped ? mapped : chunk.data();
+                int64_t end = FindByte(bytes, '\n', position, chunkEnd);
+                line.insert(line.end(), bytes + position, bytes + end);
+                position = end;
+                if (end < (int64_t) chunkEnd) {
+                    position++;
+                    break;
+                }
+            }
+            int64_t length = line.size() - sizeof(int64_t);
+            memcpy(line.data(), &length, sizeof length);
+            line.push_back(0);
+            return line.data() + sizeof(int64_t);
+        }
+    };
+
+    // Readers by handle; 0 is standard input
+    vector<unique_ptr<Reader>> Readers;
+
+    Reader &GetReader(int64_t handle) {
+        if (handle == 0 && Readers.empty())
+            Readers.push_back(make_unique<Reader>(STDIN_FILENO));
+        if (handle < 0 || handle >= (int64_t) Readers.size() || !Readers[handle]) {
+            Output.Flush();
+            cerr << "Invalid file handle " << handle << endl;
+            exit(1);
+        }
+        return *Readers[handle];
+    }
+}
+
+extern "C" int64_t openFile(const char *path){
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return -1;
+    GetReader(0);
+    auto unused = find(Readers.begin() + 1, Readers.end(), nullptr);
+    auto reader = make_unique<Reader>(file);
+    if (unused != Readers.end()) {
+        *unused = move(reader);
+        return unused - Readers.begin();
+    }
+    Readers.push_back(move(reader));
+    return Readers.size() - 1;
+}
+
+extern "C" void closeFile(int64_t handle){
+    GetReader(handle);
+    if (handle != 0)
+        Readers[handle].reset();
+}
+
+extern "C" char hasLine(int64_t handle){
+    return GetReader(handle).HasLine();
+}
+
+extern "C" char *readLine(int64_t handle){
+    return GetReader(handle).ReadLine();
+}
+
+extern "C" double parseNumber(const char *text){
+    double number;
+    auto end = text + Length(text);
+    auto result = from_chars(text + (*text == '+'), end, number);
+    return result.ec == errc() && result.ptr == end ? number : NAN;
+}
+
+extern "C" int64_t parseInt(const char *text){
+    int64_t number;
+    auto end = text + Length(text);
+    auto result = from_chars(text + (*text == '+'), end, number);
+    return result.ec == errc() && result.ptr == end ? number : 0;
 }
 
 extern "C" char *input(){
-    string str;
-    getline(cin, str);
-    return strdup(str.c_str());
+    auto line = GetReader(0).ReadLine();
+    return t_string_new(line, Length(line));
 }
 
 extern "C" char isEqual(const char* str1, const char* str2){
-    return strcmp(str1, str2) == 0;
-}
\ No newline at end of file
+    return t_string_equal(str1, str2);
+}
+
+extern "C" TList *t_list_new(int64_t elementSize){
+    auto list = (TList *) AllocateInCurrentRegion(sizeof(TList));
+    *list = {0, 0, nullptr, elementSize, (int64_t) Depth - 1};
+    return list;
+}
+
+extern "C" void t_list_reserve(TList *list, int64_t capacity){
+    if (capacity <= list->capacity)
+        return;
+    capacity = max(capacity, max(list->capacity * 2, (int64_t) 8));
+    // the global region is never released, so its lists grow on the heap where realloc doesn't waste the old space
+    if (list->region == 0) {
+        list->data = (char *) realloc(list->data, capacity * list->elementSize);
+        if (!list->data) {
+            cerr << "Out of memory growing a list to " << capacity << " elements" << endl;
+            exit(1);
+        }
+    }
+    else
+        list->data = Reallocate(list->region, list->data, list->capacity * list->elementSize,
+                                capacity * list->elementSize);
+    memset(list->data + list->capacity * list->elementSize, 0, (capacity - list->capacity) * list->elementSize);
+    list->capacity = capacity;
+}
+
+extern "C" void t_list_resize(TList *list, int64_t length, const char *fill){
+    if (length <= 0)
+        t_index_out_of_bounds(length - 1, list->length);
+    t_list_reserve(list, length);
+    if (length <= list->length)
+        return;
+    if (fill)
+        for (int64_t i = list->length; i < length; i++)
+            memcpy(list->data + i * list->elementSize, fill, list->elementSize);
+    list->length = length;
+}
+
+extern "C" void t_index_out_of_bounds(int64_t index, int64_t length){
+    Output.Flush();
+    cerr << "Index " << index << " out of bounds for length " << length << endl;
+    exit(1);
+}
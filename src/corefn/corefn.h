@@ -4,8 +4,75 @@
 
 #pragma once
 
+#include <cstdint>
+
 extern "C" void printString(const char* str);
 extern "C" void printAscii(double c);
 extern "C" void printNumber(double number);
+// Reads a line from standard input as a new string. Reading input writes out pending output first, so prompts are
+// shown.
 extern "C" char *input();
-extern "C" char isEqual(const char* str1, const char* str2);
\ No newline at end of file
+
+// Files are read line by line through handles; handle 0 is standard input. openFile returns -1 if the file can't be
+// opened.
+extern "C" int64_t openFile(const char *path);
+extern "C" void closeFile(int64_t handle);
+extern "C" char hasLine(int64_t handle);
+// The next line without its newline. The string is reused for the next line of the same handle, so it is only valid
+// until then.
+extern "C" char *readLine(int64_t handle);
+// The number or integer a string holds; NaN or 0 if it holds anything else
+extern "C" double parseNumber(const char *text);
+extern "C" int64_t parseInt(const char *text);
+extern "C" char isEqual(const char* str1, const char* str2);
+
+// Strings and lists are allocated in the current region. Compiled code enters a region at the start of a loop
+// iteration or function call that can't let a string or list escape, and leaves it at the end, which releases
+// everything allocated in it. Region 0 is the global region, which is never left.
+extern "C" int64_t t_region_enter();
+// Leaves region and all regions entered after it
+extern "C" void t_region_leave(int64_t region);
+
+// Header of a list; list values are pointers to one of these. Elements past the length are zeroed.
+struct TList {
+    int64_t length;
+    int64_t capacity;
+    char *data;
+    int64_t elementSize;
+    int64_t region;     // the list grows within the region it was created in
+};
+
+extern "C" TList *t_list_new(int64_t elementSize);
+// Makes room for at least capacity elements, growing geometrically
+extern "C" void t_list_reserve(TList *list, int64_t capacity);
+// Extends the list to the given length with copies of the element at fill, or zeroed elements if fill is NULL.
+// Indexing grows lists to index + 1 elements, so a length of zero or less comes from a negative index and stops the
+// program like one out of bounds.
+extern "C" void t_list_resize(TList *list, int64_t length, const char *fill);
+
+// Output is buffered; flush writes it out, which otherwise happens when the buffer is full and at exit
+extern "C" void flush();
+// Writes a list of numbers with separator between them
+extern "C" void printList(TList *numbers, const char *separator);
+// Writes a list of chars as they are
+extern "C" void writeBytes(TList *bytes);
+
+// Called when an index is out of range: by code compiled with --checked-indexing and for negative list indices;
+// doesn't return
+extern "C" void t_index_out_of_bounds(int64_t index, int64_t length);
+
+// Strings are stored as [int64_t length][bytes][0]; string values point at the bytes, so they can still be passed
+// where C strings are expected.
+extern "C" char *t_string_new(const char *bytes, int64_t length);
+// Copies a zero-terminated C string, e.g. the result of an extern function, into a string; NULL becomes ""
+extern "C" char *t_string_from_c(const char *str);
+extern "C" char t_string_equal(const char *str1, const char *str2);
+// Negative, zero or positive if str1 sorts before, equal to or after str2 bytewise
+extern "C" int32_t t_string_compare(const char *str1, const char *str2);
+extern "C" char *t_string_concat(const char *str1, const char *str2);
+// Index of the first occurrence of needle in haystack, or -1
+extern "C" int64_t t_string_find(const char *haystack, const char *needle);
+// Number of occurrences of c in str
+extern "C" int64_t t_string_count(const char *str, unsigned char c);
+// Parts of str between separators, as a list of strings
+extern "C" TList *t_string_split(const char *str, unsigned char separator);
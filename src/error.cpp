@@ -1,7 +1,6 @@
 //
 // Created by tommasopeduzzi on 12/08/2021.
 //
-#pragma once
 
 #include "error.h"
 #include "lexer.h"
@@ -12,7 +11,7 @@
 
 namespace t {
     llvm::Value *LogError(const FileLocation location, const string message) {
-        cout << location.file << ":" << location.line <<":" << location.column << ": "
+        cout << location.file.str() << ":" << location.line <<":" << location.column << ": "
             << RED << "Error: "<< RESET<<  message << endl;
         return nullptr;
     }
@@ -22,4 +21,8 @@ namespace t {
         return nullptr;
     }
 
+    void StopCompilation() {
+        throw CompilationError();
+    }
+
 }
\ No newline at end of file
@@ -10,4 +10,10 @@
 namespace t{
     llvm::Value *LogError(const FileLocation location, string message);
     llvm::Value *LogError(string message);
+
+    // Thrown by StopCompilation; the compilation session it unwinds is abandoned, other sessions of a batch go on
+    struct CompilationError {};
+
+    // Stops compiling the current program after an error was logged, by throwing a CompilationError
+    [[noreturn]] void StopCompilation();
 }
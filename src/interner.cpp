@@ -0,0 +1,50 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include "interner.h"
+
+namespace t {
+
+    namespace {
+        // std::deque never moves its elements, so the string_view keys stay valid while the table grows
+        struct StringTable {
+            std::deque<std::string> Strings{""};
+            std::unordered_map<std::string_view, uint32_t> Ids{{Strings.front(), 0}};
+            // compilation sessions on other threads intern strings too; most of them already are
+            std::shared_mutex Mutex;
+        };
+
+        StringTable &GetStringTable() {
+            static StringTable Table;
+            return Table;
+        }
+    }
+
+    InternedString InternedString::get(std::string_view string) {
+        auto &Table = GetStringTable();
+        {
+            std::shared_lock<std::shared_mutex> Lock(Table.Mutex);
+            auto it = Table.Ids.find(string);
+            if (it != Table.Ids.end())
+                return InternedString(it->second);
+        }
+        std::unique_lock<std::shared_mutex> Lock(Table.Mutex);
+        auto it = Table.Ids.find(string);
+        if (it != Table.Ids.end())
+            return InternedString(it->second);
+        auto id = (uint32_t) Table.Strings.size();
+        Table.Ids.emplace(Table.Strings.emplace_back(string), id);
+        return InternedString(id);
+    }
+
+    const std::string &InternedString::str() const {
+        auto &Table = GetStringTable();
+        std::shared_lock<std::shared_mutex> Lock(Table.Mutex);
+        return Table.Strings[Id];
+    }
+}
@@ -0,0 +1,46 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace t {
+
+    // Handle to a string stored once in the global string table. Two InternedStrings are equal exactly when their
+    // ids are, so comparing names costs an integer compare instead of a string compare. The table is shared by all
+    // threads.
+    class InternedString {
+        uint32_t Id = 0;
+
+        explicit InternedString(uint32_t id) : Id(id) {}
+
+    public:
+        // The default InternedString is the empty string
+        InternedString() = default;
+
+        static InternedString get(std::string_view string);
+
+        const std::string &str() const;
+
+        uint32_t id() const { return Id; }
+
+        bool empty() const { return Id == 0; }
+
+        bool operator==(InternedString other) const { return Id == other.Id; }
+
+        bool operator!=(InternedString other) const { return Id != other.Id; }
+
+        bool operator<(InternedString other) const { return Id < other.Id; }
+    };
+
+}
+
+template<>
+struct std::hash<t::InternedString> {
+    size_t operator()(t::InternedString string) const { return string.id(); }
+};
@@ -3,31 +3,75 @@
 //
 
 #include <string>
-#include <regex>
 #include "error.h"
 #include "lexer.h"
 
 namespace t {
 
     bool operator==(const Token &lhs, const char c) {
-        return std::holds_alternative<std::string>(lhs.value) && std::get<std::string>(lhs.value) == std::string(1, c);
+        return lhs.op == punctuator(c);
     }
 
     bool operator!=(const Token &lhs, const char c) {
         return !(lhs == c);
     }
 
+    static Token StringToken(TokenType type, std::string_view value) {
+        Token token{type};
+        token.string = InternedString::get(value);
+        return token;
+    }
+
+    static Token PunctuatorToken(TokenType type, Punctuator op) {
+        Token token{type};
+        token.op = op;
+        return token;
+    }
+
+    // The character an escape sequence like \n stands for, given the character after the backslash
+    static char Unescape(char c) {
+        switch (c) {
+            case 'a':
+                return '\a';
+            case 'b':
+                return '\b';
+            case 'n':
+                return '\n';
+            case 't':
+                return '\t';
+            case 'v':
+                return '\v';
+            case 'r':
+                return '\r';
+            case 'f':
+                return '\f';
+            case 'e':
+                return (char) 27;
+            default:
+                return c;
+        }
+    }
+
     Lexer::Lexer(std::string filePath) {
-        file.open(filePath);
-        location = {filePath, 1, 0};
+        // Read the whole file with a single read instead of going through the stream once per character
+        std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+        if (file) {
+            Source.resize(file.tellg());
+            file.seekg(0);
+            file.read(Source.data(), Source.size());
+        }
+        Current = LastCharPosition = Source.data();
+        End = Source.data() + Source.size();
+        location = {InternedString::get(filePath), 1, 0};
     }
 
     char Lexer::getChar() {
-        char c = file.get();
         location.column++;
-        if (file.eof()) {
+        LastCharPosition = Current;
+        if (Current == End) {
             return EOF;
         }
+        char c = *Current++;
         if (c == '\n') {
             location.line++;
             location.column = 0;
@@ -43,115 +87,81 @@ namespace t {
 
         // Handle Identifiers
         if (isAlpha(LastChar)) {
-            std::string Token = "";
-            Token += LastChar;
-            while (isAlphaNum(LastChar = getChar()))
-                Token += LastChar;
-
-            if (Token == "def")
-                return {TokenType::DEF_TOKEN};
-            else if (Token == "extern")
-                return {TokenType::EXTERN_TOKEN};
-            else if (Token == "asm")
-                return {TokenType::ASM_TOKEN};
-            else if (Token == "return")
-                return {TokenType::RETURN_TOKEN};
-            else if (Token == "end")
-                return {TokenType::END_TOKEN};
-            else if (Token == "var")
-                return {TokenType::VAR_TOKEN};
-            else if (Token == "if")
-                return {TokenType::IF_TOKEN};
-            else if (Token == "else")
-                return {TokenType::ELSE_TOKEN};
-            else if (Token == "do")
-                return {TokenType::DO_TOKEN};
-            else if (Token == "for")
-                return {TokenType::FOR_TOKEN};
-            else if (Token == "while")
-                return {TokenType::WHILE_TOKEN};
-            else if (Token == "import")
-                return {TokenType::IMPORT_TOKEN};
-            else if (Token == "struct")
-                return {TokenType::STRUCT_TOKEN};
-            else if (Token == "of")
-                return {TokenType::OF_TOKEN};
-            else if (Types.find(Token) != Types.end()) {
-                return {TokenType::TYPE, Token};
-            } else if (Token == "true") {
+            char *Start = LastCharPosition;
+            while (isAlphaNum(LastChar = getChar()));
+            std::string_view Token(Start, LastCharPosition - Start);
+
+            auto Keyword = getKeyword(Token);
+            if (Keyword != TokenType::IDENTIFIER)
+                return {Keyword};
+            if (Token == "true")
                 return {TokenType::BOOL, true};
-            } else if (Token == "false") {
+            if (Token == "false")
                 return {TokenType::BOOL, false};
-            } else
-                return {TokenType::IDENTIFIER, Token};
+            auto Name = InternedString::get(Token);
+            if (Types.find(Name) != Types.end())
+                return StringToken(TokenType::TYPE, Token);
+            return StringToken(TokenType::IDENTIFIER, Token);
         }
 
         if (LastChar == '"') {
-            std::string Value = "";
+            // Escape sequences never make a literal longer, so the value is written back into the source buffer
             LastChar = getChar();
+            char *Start = LastCharPosition;
+            char *Value = Start;
             while (LastChar != '"' && LastChar != EOF) {
                 if (LastChar == '\\'){
                     LastChar = getChar();
-                    switch(LastChar){
-                        case 'a':
-                            Value += '\a';
-                            break;
-                        case 'b':
-                            Value += '\b';
-                            break;
-                        case 'n':
-                            Value += '\n';
-                            break;
-                        case 't':
-                            Value += '\t';
-                            break;
-                        case 'v':
-                            Value += '\v';
-                            break;
-                        case 'r':
-                            Value += '\r';
-                            break;
-                        case 'f':
-                            Value += '\f';
-                            break;
-                        case 'e':
-                            Value += (char)27;
-                            break;
-                        default:
-                            Value += LastChar;
-                            break;
-                    }
+                    *Value++ = Unescape(LastChar);
                 }
                 else{
-                    Value += LastChar;
+                    *Value++ = LastChar;
                 }
                 LastChar = getChar();
             }
             LastChar = getChar();
-            return {TokenType::STRING, Value};
+            return StringToken(TokenType::STRING, std::string_view(Start, Value - Start));
+        }
+
+        if (LastChar == '\'') {
+            LastChar = getChar();
+            char Value = LastChar;
+            if (LastChar == '\\')
+                Value = Unescape(LastChar = getChar());
+            LastChar = getChar();
+            if (LastChar != '\'') {
+                LogError(location, "Expected ' after character literal");
+                return {TokenType::ERROR};
+            }
+            LastChar = getChar();
+            Token token{TokenType::CHARACTER};
+            token.number = (uint8_t) Value;
+            return token;
         }
 
         // Handle Digits
         if (isDigit(LastChar) || LastChar == '.') {
             bool decimal = false;
-            std::string NumberString;
+            char *Start = LastCharPosition;
 
             do {
                 if (LastChar == '.') {
                     if (decimal) {
-                        LogError(location, &"Unexpected character: "[LastChar]);     //TODO: Errors and shit
+                        LogError(location, "Unexpected character: .");
                         return {TokenType::ERROR};
                     }
                     decimal = true;
                 }
-                NumberString += LastChar;
                 LastChar = getChar();
             } while (isDigit(LastChar) || LastChar == '.');
+            // copy, so strtod can't read past the end of the token
+            std::string NumberString(Start, LastCharPosition - Start);
             if (NumberString == "."){
-                return {TokenType::UNDEFINED, "."};
+                return PunctuatorToken(TokenType::UNDEFINED, punctuator('.'));
             }
-            double Value = strtod(NumberString.c_str(), 0);
-            return {TokenType::NUMBER, Value};
+            Token token{TokenType::NUMBER};
+            token.number = strtod(NumberString.c_str(), 0);
+            return token;
         }
 
         // Handle comments
@@ -165,14 +175,15 @@ namespace t {
             }
         }
 
-        if (Operators.find(std::string(1, LastChar)) != Operators.end()) {
-            std::string op = std::string(1, LastChar);
+        if (isOperator(punctuator(LastChar))) {
+            char First = LastChar;
             LastChar = getChar();
-            if (Operators.find(op + std::string(1, LastChar)) != Operators.end()) {
-                op += LastChar;
+            if (LastChar != EOF && isOperator(punctuator(First, LastChar))) {
+                auto op = punctuator(First, LastChar);
                 LastChar = getChar();
+                return PunctuatorToken(TokenType::OPERATOR, op);
             }
-            return {TokenType::OPERATOR, op};
+            return PunctuatorToken(TokenType::OPERATOR, punctuator(First));
         }
 
         // Handle EOF
@@ -181,24 +192,43 @@ namespace t {
         }
 
         // If something else; returns ascii value
-        std::string returnValue = std::string(1, LastChar);
+        auto returnValue = punctuator(LastChar);
         LastChar = getChar();
-        return {TokenType::UNDEFINED, returnValue};
-    }
-
-    bool Lexer::isDigit(char c) {
-        return std::regex_match(std::string(1, c), std::regex(digitRegex));
-    }
-
-    bool Lexer::isAlphaNum(char c) {
-        return std::regex_match(std::string(1, c), std::regex(alphaNumRegex));
+        return PunctuatorToken(TokenType::UNDEFINED, returnValue);
     }
 
-    bool Lexer::isAlpha(char c) {
-        return std::regex_match(std::string(1, c), std::regex(alphaRegex));
-    }
-
-    bool Lexer::isWhiteSpace(char c) {
-        return std::regex_match(std::string(1, c), std::regex(whitespaceRegex));
+    TokenType Lexer::getKeyword(std::string_view Identifier) {
+        // Switch on length and first character, so at most one string comparison is needed per identifier
+        switch (Identifier.size()) {
+            case 2:
+                switch (Identifier[0]) {
+                    case 'i': return Identifier == "if" ? TokenType::IF_TOKEN : TokenType::IDENTIFIER;
+                    case 'd': return Identifier == "do" ? TokenType::DO_TOKEN : TokenType::IDENTIFIER;
+                    case 'o': return Identifier == "of" ? TokenType::OF_TOKEN : TokenType::IDENTIFIER;
+                }
+                break;
+            case 3:
+                switch (Identifier[0]) {
+                    case 'd': return Identifier == "def" ? TokenType::DEF_TOKEN : TokenType::IDENTIFIER;
+                    case 'a': return Identifier == "asm" ? TokenType::ASM_TOKEN : TokenType::IDENTIFIER;
+                    case 'e': return Identifier == "end" ? TokenType::END_TOKEN : TokenType::IDENTIFIER;
+                    case 'v': return Identifier == "var" ? TokenType::VAR_TOKEN : TokenType::IDENTIFIER;
+                    case 'f': return Identifier == "for" ? TokenType::FOR_TOKEN : TokenType::IDENTIFIER;
+                }
+                break;
+            case 4:
+                return Identifier == "else" ? TokenType::ELSE_TOKEN : TokenType::IDENTIFIER;
+            case 5:
+                return Identifier == "while" ? TokenType::WHILE_TOKEN : TokenType::IDENTIFIER;
+            case 6:
+                switch (Identifier[0]) {
+                    case 'e': return Identifier == "extern" ? TokenType::EXTERN_TOKEN : TokenType::IDENTIFIER;
+                    case 'r': return Identifier == "return" ? TokenType::RETURN_TOKEN : TokenType::IDENTIFIER;
+                    case 'i': return Identifier == "import" ? TokenType::IMPORT_TOKEN : TokenType::IDENTIFIER;
+                    case 's': return Identifier == "struct" ? TokenType::STRUCT_TOKEN : TokenType::IDENTIFIER;
+                }
+                break;
+        }
+        return TokenType::IDENTIFIER;
     }
 }
\ No newline at end of file
@@ -4,19 +4,22 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <fstream>
-#include <set>
-#include <variant>
+#include <string_view>
+#include <unordered_set>
+#include "interner.h"
 
 namespace t {
     struct FileLocation {
-        std::string file;
-        int line;
-        int column;
+        InternedString file;
+        uint32_t line = 0;
+        uint32_t column = 0;
     };
 
-    enum class TokenType {
+    enum class TokenType : uint8_t {
         EOF_TOKEN,
         DEF_TOKEN,
         IMPORT_TOKEN,
@@ -37,66 +40,121 @@ namespace t {
         IDENTIFIER,
         NUMBER,
         STRING,
+        CHARACTER,
         BOOL,
         UNDEFINED,
         ERROR,
     };
 
+    // Operators and other punctuation are encoded as up to two characters packed into one integer
+    using Punctuator = uint16_t;
+
+    constexpr Punctuator punctuator(char first, char second = 0) {
+        return (uint8_t) first | (uint8_t) second << 8;
+    }
+
+    constexpr bool isOperator(Punctuator op) {
+        switch (op) {
+            case punctuator('='):
+            case punctuator('+'):
+            case punctuator('-'):
+            case punctuator('*'):
+            case punctuator('/'):
+            case punctuator('>'):
+            case punctuator('<'):
+            case punctuator('-', '>'):
+            case punctuator('>', '='):
+            case punctuator('<', '='):
+            case punctuator('=', '='):
+                return true;
+            default:
+                return false;
+        }
+    }
+
     struct Token {
-        TokenType type;
-        std::variant<std::string, double, bool> value;
+        TokenType type = TokenType::UNDEFINED;
+        // Set for BOOL tokens
+        bool boolean = false;
+        // Set for OPERATOR and UNDEFINED tokens
+        Punctuator op = 0;
+        // Set for IDENTIFIER, TYPE and STRING tokens
+        InternedString string;
+        // Set for NUMBER tokens, and to the byte value for CHARACTER tokens
+        double number = 0;
+
+        Token(TokenType type = TokenType::UNDEFINED, bool boolean = false) : type(type), boolean(boolean) {}
     };
 
-    const std::set<std::string> Operators{
-            "=",
-            "+",
-            "-",
-            "*",
-            "/"
-            ">",
-            "<",
-            "->",
-            ">=",
-            "<=",
-            "==",
+    // Character classes used by the lexer. Each entry of CharacterTable is a bitmask of these.
+    enum CharacterClass : uint8_t {
+        DIGIT = 1 << 0,
+        ALPHA = 1 << 1,
+        WHITESPACE = 1 << 2,
     };
 
+    constexpr std::array<uint8_t, 256> CharacterTable = [] {
+        std::array<uint8_t, 256> table{};
+        for (int c = '0'; c <= '9'; c++)
+            table[c] |= DIGIT;
+        for (int c = 'a'; c <= 'z'; c++)
+            table[c] |= ALPHA;
+        for (int c = 'A'; c <= 'Z'; c++)
+            table[c] |= ALPHA;
+        for (char c: {' ', '\t', '\n', '\v', '\f', '\r'})
+            table[(unsigned char) c] |= WHITESPACE;
+        return table;
+    }();
+
+    inline bool hasCharacterClass(char c, uint8_t characterClass) {
+        return CharacterTable[(unsigned char) c] & characterClass;
+    }
+
     class Lexer {
     public:
         Lexer(std::string filePath);
 
-        std::set<std::string> Types{
-                "number",
-                "bool",
-                "string",
-                "void",
-                "list"
+        std::unordered_set<InternedString> Types{
+                InternedString::get("number"),
+                InternedString::get("int"),
+                InternedString::get("i32"),
+                InternedString::get("i64"),
+                InternedString::get("f32"),
+                InternedString::get("char"),
+                InternedString::get("bool"),
+                InternedString::get("string"),
+                InternedString::get("void"),
+                InternedString::get("list")
         };
 
         char LastChar = ' ';
-        std::ifstream file;
         FileLocation location;
 
+        // Whole contents of the source file; string literals are unescaped in place
+        std::string Source;
+        char *Current = nullptr;
+        char *End = nullptr;
+        // Position of LastChar in Source (End once the end of the file has been reached)
+        char *LastCharPosition = nullptr;
+
         Token getToken();
 
         char getChar();
 
-        bool isWhiteSpace(char c);
+        static bool isWhiteSpace(char c) { return hasCharacterClass(c, WHITESPACE); }
 
-        bool isAlpha(char c);
+        static bool isAlpha(char c) { return hasCharacterClass(c, ALPHA); }
 
-        bool isAlphaNum(char c);
+        static bool isAlphaNum(char c) { return hasCharacterClass(c, ALPHA | DIGIT); }
 
-        bool isDigit(char c);
+        static bool isDigit(char c) { return hasCharacterClass(c, DIGIT); }
+
+        // Returns the keyword token type for Identifier, or TokenType::IDENTIFIER if it isn't a keyword
+        static TokenType getKeyword(std::string_view Identifier);
     };
 
     bool operator==(const Token &lhs, const char c);
 
     bool operator!=(const Token &lhs, const char c);
 
-    const std::string digitRegex = "[0-9]";
-    const std::string alphaNumRegex = "[a-zA-Z0-9]";
-    const std::string alphaRegex = "[a-zA-Z]";
-    const std::string whitespaceRegex = "\\s";
-
 }
\ No newline at end of file
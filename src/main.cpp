@@ -8,6 +8,7 @@
 #include <llvm/Transforms/Scalar/SimplifyCFG.h>
 #include <llvm/Transforms/Utils/Mem2Reg.h>
 #include <llvm/ADT/Statistic.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
 #include <llvm/IR/PassManager.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
@@ -16,7 +17,16 @@
 #include <llvm/IR/IRPrintingPasses.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
 #include "corefn/corefn.h"
+#include "backend.h"
+#include "cache.h"
+#include "tiering.h"
 #include "passes.h"
 #include "parser.h"
 #include "nodes.h"
@@ -30,95 +40,320 @@ using namespace llvm;
 using namespace t;
 
 ExitOnError ExitOnErr;
-vector<unique_ptr<Node>> FunctionDeclarations, TopLevelExpressions;
-vector<unique_ptr<Structure>> Structures;
-set<string> ImportedFiles;
 
 // Command Line Options
 cl::OptionCategory Category("Options");
-cl::opt<string> FileName(cl::Positional, cl::Required, cl::desc("<input file>"), cl::cat(Category));
+cl::list<string> FileNames(cl::Positional, cl::OneOrMore, cl::desc("<input files>"), cl::cat(Category));
 cl::opt<bool> JIT("jit", cl::desc("Choose if program should be JIT-compiled"), cl::cat(Category));
+cl::opt<bool> Lazy("lazy", cl::desc("With --jit, compile each function when it is called for the first time"),
+                   cl::cat(Category));
+cl::opt<bool> Tiered("tiered", cl::desc("With --jit, compile at -O0 first and recompile functions called often at -O3 "
+                                        "in the background"), cl::cat(Category));
+cl::opt<unsigned> TierThreshold("tier-threshold", cl::desc("Calls after which --tiered recompiles a function "
+                                                           "(default: 1000)"), cl::init(1000), cl::cat(Category));
+cl::opt<bool> TierStats("tier-stats", cl::desc("Report the functions --tiered recompiled when the program ends"),
+                        cl::cat(Category));
+cl::opt<unsigned> Threads("threads", cl::desc("Threads compiling the program to machine code, or the files with "
+                                               "--batch; 0 for one per core (default: 1)"), cl::init(1),
+                           cl::cat(Category));
+cl::opt<bool> Batch("batch", cl::desc("Compile every input file foo.t to the object file foo.o"), cl::cat(Category));
+cl::opt<bool> TimePhases("time-phases", cl::desc("Report how long each phase of the compilation takes"),
+                         cl::cat(Category));
 cl::opt<bool> EmitIR("emit-ir", cl::desc("Emit LLVM IR for Program"), cl::cat(Category));
+cl::opt<bool> CheckedIndexingOption("checked-indexing",
+                                    cl::desc("Stop with an error when indexing arrays or strings out of bounds"),
+                                    cl::cat(Category));
+cl::opt<TargetLibraryInfoImpl::VectorLibrary> VectorLibrary(
+        "veclib", cl::desc("Vector math library that vectorized loops call for math functions (default: none)"),
+        cl::values(clEnumValN(TargetLibraryInfoImpl::NoLibrary, "none", "No vector math library"),
+                   clEnumValN(TargetLibraryInfoImpl::Accelerate, "Accelerate", "Apple's Accelerate framework"),
+                   clEnumValN(TargetLibraryInfoImpl::LIBMVEC_X86, "libmvec", "The vector math library of glibc (x86)"),
+                   clEnumValN(TargetLibraryInfoImpl::SVML, "SVML", "Intel's short vector math library")),
+        cl::init(TargetLibraryInfoImpl::NoLibrary), cl::cat(Category));
+cl::opt<bool> NoCache("no-cache", cl::desc("Always compile the program instead of using the object cache"),
+                      cl::cat(Category));
+cl::opt<string> CacheDirectory("cache-dir", cl::desc("Directory of the object cache (default: ~/.cache/t)"),
+                               cl::value_desc("directory"), cl::cat(Category));
+cl::opt<char> OptLevel("O", cl::desc("Optimization level: -O0, -O1, -O2, -O3 or -Os (default: -O0)"), cl::Prefix,
+                       cl::init('0'), cl::cat(Category));
 
-int main(int argc, char *argv[]) {
-    cl::HideUnrelatedOptions(Category);
-    cl::ParseCommandLineOptions(argc, argv);
+// Level of the default optimization pipeline to run after the t-specific passes, None for -O0
+Optional<PassBuilder::OptimizationLevel> GetOptimizationLevel() {
+    switch (OptLevel) {
+        case '1':
+            return PassBuilder::OptimizationLevel::O1;
+        case '2':
+            return PassBuilder::OptimizationLevel::O2;
+        case '3':
+            return PassBuilder::OptimizationLevel::O3;
+        case 's':
+            return PassBuilder::OptimizationLevel::Os;
+        default:
+            return None;
+    }
+}
 
-    // Parse File
-    unique_ptr<Parser> parser = make_unique<Parser>();
-    string absPath = filesystem::absolute(FileName.c_str());
-    ImportedFiles.insert(absPath);
-    parser->ParseFile(absPath, FunctionDeclarations, TopLevelExpressions, Structures, ImportedFiles);
+cl::opt<string> TargetTripleName("target", cl::desc("Target triple to generate code for (default: host)"),
+                                  cl::cat(Category));
+cl::opt<string> MCPU("mcpu", cl::desc("Target CPU, 'native' for the host CPU (default: generic, host CPU for --jit)"),
+                     cl::value_desc("cpu-name"), cl::cat(Category));
+cl::list<string> MAttrs("mattr", cl::CommaSeparated, cl::desc("Target features to enable (+) or disable (-)"),
+                        cl::value_desc("+a1,-a2,..."), cl::cat(Category));
 
-    // Check Types
-    Symbols.CreateScope();
-    for (auto &structure: Structures) {
-        structure->checkType();
+// Resolves --mcpu and --mattr into the CPU name and feature string to generate code for
+pair<string, string> GetCPUAndFeatures() {
+    string CPU = MCPU;
+    SubtargetFeatures Features;
+    // the JIT runs on the host, so it targets the host CPU unless told otherwise
+    if (CPU == "native" || (CPU.empty() && JIT)) {
+        CPU = sys::getHostCPUName().str();
+        StringMap<bool> HostFeatures;
+        if (sys::getHostCPUFeatures(HostFeatures))
+            for (auto &Feature: HostFeatures)
+                Features.AddFeature(Feature.first(), Feature.second);
     }
-    for (auto &node: FunctionDeclarations) {
-        node->checkType();
+    if (CPU.empty())
+        CPU = "generic";
+    for (auto &Attribute: MAttrs)
+        Features.AddFeature(Attribute);
+    return {CPU, Features.getString()};
+}
+
+// Shared library the JIT loads for the vector math library; compiled programs have to be linked against it instead
+const char *GetVectorLibraryPath() {
+    switch (VectorLibrary) {
+        case TargetLibraryInfoImpl::Accelerate:
+            return "/System/Library/Frameworks/Accelerate.framework/Accelerate";
+        case TargetLibraryInfoImpl::LIBMVEC_X86:
+            return "libmvec.so.1";
+        case TargetLibraryInfoImpl::SVML:
+            return "libsvml.so";
+        default:
+            return nullptr;
     }
-    for (auto &node: TopLevelExpressions) {
-        node->checkType();
+}
+
+CodeGenOpt::Level GetCodeGenOptLevel() {
+    switch (OptLevel) {
+        case '0':
+            return CodeGenOpt::None;
+        case '1':
+            return CodeGenOpt::Less;
+        case '3':
+            return CodeGenOpt::Aggressive;
+        default:
+            return CodeGenOpt::Default;
     }
-    Symbols.Reset();
+}
 
-    //Initialize LLVM for codegen
-    // TODO: Figure out linking with all llvm components for initializing all targets
-    InitializeNativeTarget();
-    InitializeNativeTargetAsmPrinter();
-    InitializeLLVM();
+// Everything besides the source files that the compiled program depends on: the compiler itself and the options
+string DescribeOptions(const char *Argv0, const string &Path, const string &TargetTriple, const string &CPU,
+                       const string &Features) {
+    string Options;
+    raw_string_ostream Stream(Options);
+    auto Executable = sys::fs::getMainExecutable(Argv0, (void *) &DescribeOptions);
+    sys::fs::file_status Status;
+    if (!sys::fs::status(Executable, Status))
+        Stream << Executable << " " << Status.getSize() << " "
+               << Status.getLastModificationTime().time_since_epoch().count() << "\n";
+    Stream << Path << "\n" << (JIT ? "jit" : "object") << " -O" << OptLevel << " " << TargetTriple << " " << CPU
+           << " " << Features << " " << CheckedIndexingOption << " " << (int) VectorLibrary << "\n";
+    return Stream.str();
+}
 
-    // setup Target
-    // TODO: Change target based on user input
-    auto TargetTriple = sys::getDefaultTargetTriple();
-    std::string Error;
-    auto Target = TargetRegistry::lookupTarget(TargetTriple, Error);
-    if (!Target) {
-        errs() << Error;
-        return 1;
-    }
-    auto CPU = "generic";
-    auto Features = "";
-    TargetOptions opt;
-    auto RM = Optional<Reloc::Model>();
-    auto TargetMachine = Target->createTargetMachine(TargetTriple, CPU, Features, opt, RM);
+orc::JITTargetMachineBuilder CreateJITTargetMachineBuilder(const string &TargetTriple, const string &CPU,
+                                                           const string &Features, CodeGenOpt::Level Level) {
+    orc::JITTargetMachineBuilder JTMB((Triple(TargetTriple)));
+    JTMB.setCPU(CPU);
+    JTMB.getFeatures() = SubtargetFeatures(Features);
+    JTMB.setCodeGenOptLevel(Level);
+    return JTMB;
+}
 
-    t::Module->setDataLayout(TargetMachine->createDataLayout());
-    t::Module->setTargetTriple(TargetTriple);
+// Sets up the JIT with the runtime and the vector math library; compiled objects are stored in Cache if there is one.
+// A lazy JIT is an LLLazyJIT, whose CompileOnDemandLayer compiles each function on its first call.
+unique_ptr<orc::LLJIT> CreateJIT(const string &TargetTriple, const string &CPU, const string &Features,
+                                 ObjectCache *Cache, bool Lazy = false, unsigned CompileThreads = 1) {
+    auto JTMB = CreateJITTargetMachineBuilder(TargetTriple, CPU, Features, GetCodeGenOptLevel());
+    auto CreateCompiler = [Cache, CompileThreads](orc::JITTargetMachineBuilder JTMB)
+            -> Expected<unique_ptr<orc::IRCompileLayer::IRCompiler>> {
+        // every compile thread needs a target machine of its own
+        if (CompileThreads > 1)
+            return make_unique<orc::ConcurrentIRCompiler>(move(JTMB), Cache);
+        auto TargetMachine = JTMB.createTargetMachine();
+        if (!TargetMachine)
+            return TargetMachine.takeError();
+        return make_unique<orc::TMOwningSimpleCompiler>(move(*TargetMachine), Cache);
+    };
+    unique_ptr<orc::LLJIT> JIT;
+    if (Lazy)
+        JIT = ExitOnErr(orc::LLLazyJITBuilder().setJITTargetMachineBuilder(move(JTMB))
+                                .setCompileFunctionCreator(CreateCompiler).create());
+    else
+        JIT = ExitOnErr(orc::LLJITBuilder().setJITTargetMachineBuilder(move(JTMB))
+                                .setCompileFunctionCreator(CreateCompiler)
+                                .setNumCompileThreads(CompileThreads > 1 ? CompileThreads : 0).create());
 
-    // Create Entry Function
-    auto entryFunction = make_unique<t::Function>("main", move(make_shared<t::Type>("number")), FileLocation(),
-                                                  vector<pair<shared_ptr<t::Type>, string>>(),
-                                                  move(TopLevelExpressions));
+    auto &jd = JIT->getMainJITDylib();
+    auto &dl = JIT->getDataLayout();
 
-    // Codegen Function and Structure-Declarations
-    for (auto &Decl: FunctionDeclarations) {
-        auto IR = Decl->codegen();
+    // TODO: Fix static dynamic library path
+    if(auto DSLGO = orc::DynamicLibrarySearchGenerator::Load("./cmake-build-debug/corefn/libt_corefn.dylib",
+                                                             dl.getGlobalPrefix()))
+        jd.addGenerator(move(*DSLGO));
+    else{
+        std::cerr << "Failed to load dynamic library with core functions.\n";
+        exit(1);
+    }
+    if (auto Path = GetVectorLibraryPath()) {
+        if (auto Generator = orc::DynamicLibrarySearchGenerator::Load(Path, dl.getGlobalPrefix()))
+            jd.addGenerator(move(*Generator));
+        else {
+            std::cerr << "Failed to load vector math library: " << toString(Generator.takeError()) << "\n";
+            exit(1);
+        }
     }
-    for (auto &Decl: Structures) {
-        auto IR = Decl->codegen();
+    return JIT;
+}
+
+// Runs main of the program the JIT holds and returns its result
+double RunJIT(orc::LLJIT &JIT) {
+    auto EntrySym = JIT.lookup("main");
+    if (!EntrySym) {
+        std::cerr << "Error loading entry-function!\n";
+        exit(1);
     }
+    auto *Expr = (double (*)()) EntrySym->getAddress();
+    return Expr();
+}
 
-    // Codegen Entry Function
-    auto entry = entryFunction->codegen();
-    if (!entry)
+// Writes Object to a temporary file that replaces Filename once it is complete, so Filename is never left half written
+int WriteObjectFile(const string &Filename, StringRef Object) {
+    int FD;
+    SmallString<128> TemporaryName;
+    if (auto EC = sys::fs::createUniqueFile(Filename + "-%%%%%%.tmp", FD, TemporaryName)) {
+        errs() << "Could not open file: " << EC.message() << "\n";
+        return 1;
+    }
+    {
+        raw_fd_ostream dest(FD, true);
+        dest << Object;
+        dest.close();
+        if (dest.has_error()) {
+            errs() << "Could not write " << Filename << ": " << dest.error().message() << "\n";
+            dest.clear_error();
+            sys::fs::remove(TemporaryName);
+            return 1;
+        }
+    }
+    if (auto EC = sys::fs::rename(TemporaryName, Filename)) {
+        errs() << "Could not write " << Filename << ": " << EC.message() << "\n";
+        sys::fs::remove(TemporaryName);
         return 1;
+    }
+    return 0;
+}
 
-    // Preapare and Run Pass Manager
-    LoopAnalysisManager LAM;
-    FunctionAnalysisManager FAM;
-    CGSCCAnalysisManager CGAM;
-    ModuleAnalysisManager MAM;
+// Measures the phases of a compilation one after another for --time-phases
+class PhaseTimer {
+    chrono::steady_clock::time_point Start = chrono::steady_clock::now();
 
-    PassBuilder PB;
+public:
+    // Seconds since the previous phase ended
+    double Elapsed() const { return chrono::duration<double>(chrono::steady_clock::now() - Start).count(); }
 
-    PB.registerModuleAnalyses(MAM);
-    PB.registerCGSCCAnalyses(CGAM);
-    PB.registerFunctionAnalyses(FAM);
-    PB.registerLoopAnalyses(LAM);
-    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    // Reports the time since the previous phase ended, followed by Details, and starts the next phase
+    void Report(StringRef Phase, const Twine &Details = "") {
+        auto Milliseconds = Elapsed() * 1000;
+        Start = chrono::steady_clock::now();
+        if (!TimePhases)
+            return;
+        string Line;
+        raw_string_ostream Stream(Line);
+        Stream << Phase << ": " << format("%.1f", Milliseconds) << " ms" << Details << "\n";
+        errs() << Stream.str();     // in one piece, sessions on other threads report too
+    }
+};
+
+unique_ptr<llvm::TargetMachine> CreateTargetMachine(const Target &Target, const string &TargetTriple,
+                                                    const string &CPU, const string &Features) {
+    return unique_ptr<llvm::TargetMachine>(Target.createTargetMachine(TargetTriple, CPU, Features, TargetOptions(),
+                                                                      None, None, GetCodeGenOptLevel()));
+}
+
+// Parses, checks and generates the program at Path into the module of Session and optimizes it for TargetMachine.
+// The files the program consists of are recorded in Cache as they are parsed. Returns false if no valid module could be generated.
+bool GenerateModule(CompilationSession &Session, const string &Path, ObjectFileCache *Cache,
+                    llvm::TargetMachine &TargetMachine, const string &CPU, const string &Features, PhaseTimer &Timer) {
+    // StopCompilation unwinds to here, an error ends only this session
+    try {
+        // Parse File
+        Session.Cache = Cache;
+        unique_ptr<Parser> parser = make_unique<Parser>(Session);
+        Session.ImportedFiles.insert(Path);
+        parser->ParseFile(Path);
+        Timer.Report("parse", ", " + Twine(Session.Tokens) + " tokens (" +
+                              Twine((uint64_t) (Session.Tokens / Timer.Elapsed())) + " tokens/s), " +
+                              Twine(Session.NodeArena.getBytesAllocated() / 1024) + " KB of AST");
+        if (Cache)
+            Cache->SetSources();
+
+        Session.CheckedIndexing = CheckedIndexingOption;
+
+        // Check Types
+        Session.Symbols.CreateScope();
+        for (auto &structure: Session.Structures) {
+            structure->checkType(Session);
+        }
+        for (auto &node: Session.FunctionDeclarations) {
+            node->checkType(Session);
+        }
+        for (auto &node: Session.TopLevelExpressions) {
+            node->checkType(Session);
+        }
+        Session.Symbols.Reset();
+        Timer.Report("check");
+
+        Session.Module->setDataLayout(TargetMachine.createDataLayout());
+        Session.Module->setTargetTriple(TargetMachine.getTargetTriple().str());
+
+        // Create Entry Function
+        auto entryFunction = Session.NodeArena.make<t::Function>(InternedString::get("main"), Types.Number,
+                                                                 FileLocation(),
+                                                                 vector<pair<t::Type *, InternedString>>(),
+                                                                 move(Session.TopLevelExpressions));
+
+        // Codegen Function and Structure-Declarations
+        for (auto &Decl: Session.FunctionDeclarations) {
+            Decl->codegen(Session);
+        }
+        for (auto &Decl: Session.Structures) {
+            Decl->codegen(Session);
+        }
+
+        // Codegen Entry Function
+        auto entry = entryFunction->codegen(Session);
+        if (!entry)
+            return false;
+
+        // The AST isn't needed anymore after codegen
+        Session.ReleaseNodes();
+        Timer.Report("codegen");
+    } catch (const CompilationError &) {
+        return false;
+    }
+
+    // Let the optimizer and backend use everything the selected CPU supports, e.g. for vectorization
+    for (auto &Function: *Session.Module) {
+        if (Function.isDeclaration())
+            continue;
+        Function.addFnAttr("target-cpu", CPU);
+        if (!Features.empty())
+            Function.addFnAttr("target-features", Features);
+    }
 
+    // Preapare and Run Pass Manager
+    Optimizer Opt(&TargetMachine, TargetMachine.getTargetTriple(), VectorLibrary);
     ModulePassManager MPM;
 
     if (EmitIR)
@@ -128,65 +363,184 @@ int main(int argc, char *argv[]) {
     MPM.addPass(createModuleToFunctionPassAdaptor(RemoveAfterFirstTerminatorPass()));
     MPM.addPass(createModuleToFunctionPassAdaptor(SimplifyCFGPass()));
     MPM.addPass(createModuleToFunctionPassAdaptor(PromotePass()));
-    MPM.run(*t::Module, MAM);
+    MPM.addPass(createModuleToFunctionPassAdaptor(BoundsCheckEliminationPass()));
+    MPM.run(*Session.Module, Opt.MAM);
 
     // Verify Correctness of Module
-    if (verifyModule(*t::Module)) {
+    if (verifyModule(*Session.Module)) {
         cerr << "LLVM Module faulty. Use '--emit-llvm' to debug. \n";
+        return false;
+    }
+
+    // Run the standard pipeline only on verified IR, the t-specific passes above are what make it valid
+    if (auto Level = GetOptimizationLevel())
+        Opt.Optimize(*Session.Module, *Level);
+    Timer.Report("optimize");
+    return true;
+}
+
+// Compiles the program at Path into the object file Output, unless the cache already holds the object
+int CompileObjectFile(const char *Argv0, const Target &Target, const string &TargetTriple, const string &CPU,
+                      const string &Features, const string &Path, const string &Output, unsigned Threads) {
+    // An unchanged program compiled with the same options isn't compiled again
+    unique_ptr<ObjectFileCache> Cache;
+    if (!NoCache && !EmitIR) {
+        Cache = make_unique<ObjectFileCache>(CacheDirectory.empty() ? GetDefaultCacheDirectory() : CacheDirectory,
+                                             DescribeOptions(Argv0, Path, TargetTriple, CPU, Features));
+        if (auto Object = Cache->Lookup())
+            return WriteObjectFile(Output, Object->getBuffer());
+    }
+
+    CompilationSession Session;
+    auto TargetMachine = CreateTargetMachine(Target, TargetTriple, CPU, Features);
+    PhaseTimer Timer;
+    if (!GenerateModule(Session, Path, Cache.get(), *TargetMachine, CPU, Features, Timer))
+        return 1;
+
+    SmallVector<char, 0> Object;
+    auto CreatePartTargetMachine = [&] { return CreateTargetMachine(Target, TargetTriple, CPU, Features); };
+    if (auto Err = EmitObjectFile(*Session.Module, Threads, CreatePartTargetMachine, Object)) {
+        errs() << toString(move(Err)) << "\n";
         return 1;
     }
+    Timer.Report("emit");
+    StringRef ObjectBuffer(Object.data(), Object.size());
+    if (Cache)
+        Cache->Store(MemoryBufferRef(ObjectBuffer, Output));
+    return WriteObjectFile(Output, ObjectBuffer);
+}
 
-    // Create And Run JIT
-    if (JIT) {
-        auto JIT = ExitOnErr(orc::LLJITBuilder().create());
-        if (!JIT)
-            exit(1);
+// Compiles every input file foo.t to foo.o in a session of its own, --threads files at a time
+int CompileBatch(const char *Argv0, const Target &Target, const string &TargetTriple, const string &CPU,
+                 const string &Features) {
+    ThreadPool Pool(hardware_concurrency(GetThreadCount(Threads)));
+    // one entry per file, each written only by the task compiling that file
+    vector<char> Failed(FileNames.size(), false);
+    for (size_t i = 0; i < FileNames.size(); i++) {
+        Pool.async([&, i] {
+            SmallString<128> Output(FileNames[i]);
+            sys::path::replace_extension(Output, "o");
+            Failed[i] = CompileObjectFile(Argv0, Target, TargetTriple, CPU, Features,
+                                          filesystem::absolute(FileNames[i]), Output.str().str(), 1) != 0;
+        });
+    }
+    Pool.wait();
 
-        auto &jd = JIT->getMainJITDylib();
-        auto &dl = JIT->getDataLayout();
+    // a file that failed doesn't stop the others, they are all reported at the end
+    int Failures = 0;
+    for (size_t i = 0; i < FileNames.size(); i++) {
+        if (!Failed[i])
+            continue;
+        errs() << (Failures++ ? ", " : "Failed to compile ") << FileNames[i];
+    }
+    if (!Failures)
+        return 0;
+    errs() << " (" << Failures << " of " << FileNames.size() << " files)\n";
+    return 1;
+}
 
-        // TODO: Fix static dynamic library path
-        if(auto DSLGO = orc::DynamicLibrarySearchGenerator::Load("./cmake-build-debug/corefn/libt_corefn.dylib",
-                                                                 dl.getGlobalPrefix()))
-            jd.addGenerator(move(*DSLGO));
-        else{
-            std::cerr << "Failed to load dynamic library with core functions.\n";
-            return 1;
-        }
+int main(int argc, char *argv[]) {
+    cl::HideUnrelatedOptions(Category);
+    cl::ParseCommandLineOptions(argc, argv);
+    if (string("0123s").find(OptLevel) == string::npos) {
+        errs() << "Unknown optimization level -O" << OptLevel << "\n";
+        return 1;
+    }
+    if (Tiered && (!JIT || Lazy)) {
+        errs() << "--tiered needs --jit and can't be combined with --lazy\n";
+        return 1;
+    }
+    if (Tiered)
+        OptLevel = '0';     // the first tier, the second is -O3
+    if (FileNames.size() > 1 && !Batch) {
+        errs() << "Compiling several files needs --batch\n";
+        return 1;
+    }
+    if (Batch && (JIT || EmitIR)) {
+        errs() << "--batch writes object files and can't be combined with --jit or --emit-ir\n";
+        return 1;
+    }
 
-        if (auto Err = JIT.get()->addIRModule(
-                orc::ThreadSafeModule(std::move(t::Module), std::move(Context)))) {
-            std::cerr << "Error loading module: " << toString(std::move(Err)) << "\n";
-            return 1;
-        }
-        auto EntrySym = JIT->lookup("main");
-        if (!EntrySym) {
-            std::cerr << "Error loading entry-function!\n";
-            return 1;
-        }
-        auto *Expr = (double (*)()) EntrySym->getAddress();
-        auto exitCode = Expr();
-        exit(exitCode);
-    }
-    else {
-        auto Filename = "output.o";
-        std::error_code EC;
-        raw_fd_ostream dest(Filename, EC, sys::fs::OF_None);
-        if (EC) {
-            errs() << "Could not open file: " << EC.message();
-            return 1;
-        }
-        legacy::PassManager pass;
-        auto FileType = CGFT_ObjectFile;
+    auto TargetTriple = TargetTripleName.empty() ? sys::getDefaultTargetTriple() : Triple::normalize(TargetTripleName);
+    if (JIT && Triple(TargetTriple) != Triple(sys::getProcessTriple())) {
+        errs() << "Can't JIT-compile for target " << TargetTriple << ", only for the host.\n";
+        return 1;
+    }
+    auto [CPU, Features] = GetCPUAndFeatures();
 
-        if (TargetMachine->addPassesToEmitFile(pass, dest, nullptr, FileType)) {
-            errs() << "TargetMachine can't emit a file of this type";
-            return 1;
-        }
+    //Initialize LLVM for codegen
+    InitializeAllTargetInfos();
+    InitializeAllTargets();
+    InitializeAllTargetMCs();
+    InitializeAllAsmParsers();
+    InitializeAllAsmPrinters();
+
+    // setup Target
+    std::string Error;
+    auto Target = TargetRegistry::lookupTarget(TargetTriple, Error);
+    if (!Target) {
+        errs() << Error;
+        return 1;
+    }
 
-        pass.run(*t::Module);
-        dest.flush();
+    if (Batch)
+        return CompileBatch(argv[0], *Target, TargetTriple, CPU, Features);
+    string absPath = filesystem::absolute(FileNames[0].c_str());
+    if (!JIT)
+        return CompileObjectFile(argv[0], *Target, TargetTriple, CPU, Features, absPath, "output.o",
+                                 GetThreadCount(Threads));
 
+    // An unchanged program compiled with the same options runs without being compiled again
+    unique_ptr<ObjectFileCache> Cache;
+    if (!NoCache && !EmitIR && !Tiered) {
+        Cache = make_unique<ObjectFileCache>(CacheDirectory.empty() ? GetDefaultCacheDirectory() : CacheDirectory,
+                                             DescribeOptions(argv[0], absPath, TargetTriple, CPU, Features));
+        if (auto Object = Cache->Lookup()) {
+            // the cached object holds every function compiled already, there is nothing left to compile lazily
+            if (Lazy && TimePhases)
+                errs() << "cache hit: running the cached object, --lazy has no effect\n";
+            auto CachedJIT = CreateJIT(TargetTriple, CPU, Features, nullptr);
+            ExitOnErr(CachedJIT->addObjectFile(move(Object)));
+            exit(RunJIT(*CachedJIT));
+        }
     }
 
-}
\ No newline at end of file
+    CompilationSession Session;
+    auto TargetMachine = CreateTargetMachine(*Target, TargetTriple, CPU, Features);
+    PhaseTimer Timer;
+    if (!GenerateModule(Session, absPath, Cache.get(), *TargetMachine, CPU, Features, Timer))
+        return 1;
+
+    // Create And Run JIT
+    // the parts of a program that is compiled lazily or on several threads aren't one object the cache could hold
+    auto CompileThreads = Lazy ? 1 : GetThreadCount(Threads);
+    auto JIT = CreateJIT(TargetTriple, CPU, Features, Lazy || CompileThreads > 1 ? nullptr : Cache.get(), Lazy,
+                         CompileThreads);
+    unique_ptr<TieredCompiler> Tiering;
+    if (Tiered) {
+        Tiering = make_unique<TieredCompiler>(
+                *JIT, CreateJITTargetMachineBuilder(TargetTriple, CPU, Features, CodeGenOpt::Aggressive),
+                VectorLibrary, TierThreshold);
+        Tiering->Instrument(*Session.Module);
+    }
+    vector<orc::ThreadSafeModule> Parts;
+    if (CompileThreads > 1)
+        Parts = SplitForThreads(*Session.Module, CompileThreads);
+    else
+        Parts.emplace_back(std::move(Session.Module), std::move(Session.Context));
+    for (auto &Part: Parts) {
+        auto Err = Lazy ? static_cast<orc::LLLazyJIT &>(*JIT).addLazyIRModule(move(Part))
+                        : JIT->addIRModule(move(Part));
+        if (Err) {
+            std::cerr << "Error loading module: " << toString(std::move(Err)) << "\n";
+            return 1;
+        }
+    }
+    auto exitCode = RunJIT(*JIT);
+    if (Tiering) {
+        Tiering->Finish();
+        if (TierStats)
+            Tiering->PrintStatistics(errs());
+    }
+    exit(exitCode);
+}
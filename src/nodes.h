@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "builtins.h"
 #include "type.h"
 #include "lexer.h"
 #include <memory>
@@ -11,11 +12,14 @@
 #include <map>
 #include <string>
 #include <llvm/IR/Value.h>
+#include <llvm/IR/Instructions.h>
 
 using namespace std;
 
 namespace t {
 
+    class CompilationSession;
+
     enum NodeType {
         UNKNOWN,
         EXPRESSION,
@@ -24,6 +28,7 @@ namespace t {
         NUMBER,
         BOOL,
         STRING,
+        CHARACTER,
         VARIABLE,
         INDEXING,
         BINARY_EXPRESSION,
@@ -38,11 +43,12 @@ namespace t {
         ASSEMBLY,
         STRUCTURE,
         MEMBER,
+        CAST,
     };
 
     class Node {
     public:
-        shared_ptr<Type> type;
+        Type *type = nullptr;
 
         FileLocation location;
 
@@ -50,13 +56,13 @@ namespace t {
 
         Node() = default;
 
-        Node(shared_ptr<Type> type = nullptr, FileLocation location = {}) : type(move(type)), location(location){}
+        Node(Type *type = nullptr, FileLocation location = {}) : type(type), location(location){}
 
         virtual NodeType getNodeType() const { return NodeType::UNKNOWN; }
 
-        virtual llvm::Value *codegen() = 0;
+        virtual llvm::Value *codegen(CompilationSession &Session) = 0;
 
-        virtual void checkType() = 0;
+        virtual void checkType(CompilationSession &Session) = 0;
     };
 
     class Expression : public Node {
@@ -67,13 +73,17 @@ namespace t {
 
         Expression(FileLocation location) : Node(nullptr, location){}
 
-        Expression(shared_ptr<Type> type, FileLocation location) : Node(move(type), location) {}
+        Expression(Type *type, FileLocation location) : Node(type, location) {}
 
-        virtual llvm::Value *codegen() = 0;
+        virtual llvm::Value *codegen(CompilationSession &Session) = 0;
 
-        virtual pair<llvm::Value *, llvm::Type *> getAddressAndType() {
+        virtual pair<llvm::Value *, llvm::Type *> getAddressAndType(CompilationSession &) {
             assert(false && "SOMETHING WENT TERRIBLY WRONG");
         }
+
+        // Literals take on the numeric type they're used as (e.g. the `1` in `var i32 x = 1`). Returns false if this
+        // expression can't be represented as the target type. Only valid after checkType.
+        virtual bool coerceTo(Type *) { return false; }
     };
 
     class Statement : public Node {
@@ -84,9 +94,9 @@ namespace t {
 
         Statement(FileLocation location) : Node(nullptr, location){}
 
-        Statement(shared_ptr<Type> type = nullptr, FileLocation location = {}) : Node(move(type), location) {}
+        Statement(Type *type = nullptr, FileLocation location = {}) : Node(type, location) {}
 
-        virtual llvm::Value *codegen() = 0;
+        virtual llvm::Value *codegen(CompilationSession &Session) = 0;
     };
 
 // TODO: maybe have another subclass for literals?
@@ -98,9 +108,11 @@ namespace t {
 
         Number(const double value, FileLocation location) : Expression(location), Value(value) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
+
+        virtual void checkType(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual bool coerceTo(Type *target);
     };
 
     class Bool : public Expression {
@@ -110,223 +122,284 @@ namespace t {
 
         Bool(const bool value, FileLocation location) : Expression(location), Value(value) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
     class String : public Expression {
-        string Value;
+        InternedString Value;
     public:
         virtual NodeType getNodeType() const { return NodeType::STRING; }
 
-        String(string value, FileLocation location) : Expression(location), Value(value) {}
+        String(InternedString value, FileLocation location) : Expression(location), Value(value) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
+    };
+
+    class Character : public Expression {
+        uint8_t Value;
+    public:
+        virtual NodeType getNodeType() const { return NodeType::CHARACTER; }
+
+        Character(uint8_t value, FileLocation location) : Expression(location), Value(value) {}
+
+        virtual llvm::Value *codegen(CompilationSession &Session);
+
+        virtual void checkType(CompilationSession &Session);
     };
 
     class Negative : public Expression {
-        unique_ptr<Expression> expression;
+        Expression *expression;
     public:
         virtual NodeType getNodeType() const { return NodeType::NEGATIVE; }
 
-        Negative(unique_ptr<Expression> expression, FileLocation location) : Expression(location), expression(move(expression)) {}
+        Negative(Expression *expression, FileLocation location) : Expression(location), expression(expression) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
+
+        virtual bool coerceTo(Type *target);
+    };
+
+    // Explicit numeric conversion, written like a call to the type: `i32(x)`, `number(i)`
+    class Cast : public Expression {
+        Expression *Value;
+    public:
+        virtual NodeType getNodeType() const { return NodeType::CAST; }
+
+        Cast(Type *type, Expression *value, FileLocation location) : Expression(type, location), Value(value) {}
+
+        virtual llvm::Value *codegen(CompilationSession &Session);
+
+        virtual void checkType(CompilationSession &Session);
     };
 
     class Variable : public Expression {
     public:
         virtual NodeType getNodeType() const { return NodeType::VARIABLE; }
 
-        Variable(const string name, FileLocation location) : Expression(location), Name(name) {}
+        Variable(InternedString name, FileLocation location) : Expression(location), Name(name) {}
 
-        string Name;
+        InternedString Name;
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
 
-        virtual pair<llvm::Value *, llvm::Type *> getAddressAndType();
+        virtual pair<llvm::Value *, llvm::Type *> getAddressAndType(CompilationSession &Session);
     };
 
     class Indexing : public Expression {
-        unique_ptr<Expression> Index;
-        unique_ptr<Expression> Object;
+        Expression *Object;
+        Expression *Index;
     public:
         virtual NodeType getNodeType() const { return NodeType::INDEXING; }
 
-        Indexing(unique_ptr<Expression> object, unique_ptr<Expression> index, FileLocation location) :
-            Expression(location), Object(move(object)), Index(move(index)) {}
+        Indexing(Expression *object, Expression *index, FileLocation location) :
+            Expression(location), Object(object), Index(index) {}
 
-        virtual llvm::Value *codegen();
+        // Only valid after checkType
+        bool isListElement() const { return Object->type->name == Types.ListName; }
 
-        virtual void checkType();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual pair<llvm::Value *, llvm::Type *> getAddressAndType();
+        virtual void checkType(CompilationSession &Session);
+
+        virtual pair<llvm::Value *, llvm::Type *> getAddressAndType(CompilationSession &Session);
     };
 
     class Member : public Expression {
-        unique_ptr<Expression> Object;
-        string Name;
+        Expression *Object;
+        InternedString Name;
     public:
         virtual NodeType getNodeType() const { return NodeType::MEMBER; }
 
-        Member(unique_ptr<Expression> object, string name, FileLocation location) :
-            Expression(location), Object(move(object)), Name(name) {}
+        Member(Expression *object, InternedString name, FileLocation location) :
+            Expression(location), Object(object), Name(name) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
 
-        virtual pair<llvm::Value *, llvm::Type *> getAddressAndType();
+        virtual pair<llvm::Value *, llvm::Type *> getAddressAndType(CompilationSession &Session);
     };
 
     class BinaryExpression : public Expression {
-        string Op;
-        unique_ptr<Expression> LHS, RHS;
+        Punctuator Op;
+        Expression *LHS, *RHS;
     public:
         virtual NodeType getNodeType() const { return NodeType::BINARY_EXPRESSION; }
 
-        BinaryExpression(string op, unique_ptr<Expression> lhs, unique_ptr<Expression> rhs, FileLocation location) :
-                         Expression(location), Op(op), LHS(move(lhs)), RHS(move(rhs)) {}
+        BinaryExpression(Punctuator op, Expression *lhs, Expression *rhs, FileLocation location) :
+                         Expression(location), Op(op), LHS(lhs), RHS(rhs) {}
+
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual llvm::Value *codegen();
+        virtual void checkType(CompilationSession &Session);
 
-        virtual void checkType();
+        // Emits `VariableName < bound` (or <=, >, >=) as a comparison of the integer IntegerValue of the number variable.
+        // Returns nullptr if this expression doesn't have that shape.
+        llvm::Value *codegenIntegerComparison(CompilationSession &Session, InternedString VariableName,
+                                              llvm::Value *IntegerValue);
     };
 
     class Call : public Expression {
-        string Callee;
-        std::vector<std::unique_ptr<Expression>> Arguments;
+        InternedString Callee;
+        std::vector<Expression *> Arguments;
+        // Set if the callee is a builtin rather than a function of the program
+        const Builtin *BuiltinFunction = nullptr;
+        // Set for builtins like len, whose integer result is a number unless an integer is expected; see coerceTo
+        Type *IntegerResult = nullptr;
+
+        bool checkBuiltin(CompilationSession &Session);
     public:
         virtual NodeType getNodeType() const { return NodeType::CALL; }
 
-        Call(const std::string callee, std::vector<std::unique_ptr<Expression>> arguments, FileLocation location) :
+        Call(InternedString callee, std::vector<Expression *> arguments, FileLocation location) :
             Expression(location), Callee(callee), Arguments(move(arguments)) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
+
+        // The result of a builtin as the builtin returns it, before it is converted to a number
+        llvm::Value *codegenBuiltin(CompilationSession &Session);
+
+        virtual void checkType(CompilationSession &Session);
+
+        virtual bool coerceTo(Type *target);
 
-        virtual void checkType();
+        Type *getIntegerResult() const { return IntegerResult; }
 
-        virtual std::pair<llvm::Value *, llvm::Type *> getAddressAndType();
+        virtual std::pair<llvm::Value *, llvm::Type *> getAddressAndType(CompilationSession &Session);
     };
 
     class VariableDefinition : public Statement {
-        std::string Name;
-        std::unique_ptr<Expression> Value = nullptr;
+        InternedString Name;
+        Expression *Value = nullptr;
     public:
         virtual NodeType getNodeType() const { return NodeType::VARIABLE_DEFINITION; }
 
-        VariableDefinition(std::string name, std::unique_ptr<Expression> Init, std::unique_ptr<Type> type, FileLocation location) :
-                Statement(move(type), location), Name(name), Value(std::move(Init)) {}
+        VariableDefinition(InternedString name, Expression *Init, Type *type, FileLocation location) :
+                Statement(type, location), Name(name), Value(Init) {}
 
-        VariableDefinition(std::string name, std::unique_ptr<Type> type) : Statement(move(type)), Name(name) {}
+        VariableDefinition(InternedString name, Type *type) : Statement(type), Name(name) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
     class IfStatement : public Statement {
-        std::unique_ptr<Expression> Condition;
-        std::vector<std::unique_ptr<Node>> Then, Else;
+        Expression *Condition;
+        std::vector<Node *> Then, Else;
     public:
         virtual NodeType getNodeType() const { return NodeType::IF_STATEMENT; }
 
-        IfStatement(std::unique_ptr<Expression> Cond, std::vector<std::unique_ptr<Node>> Then,
-                    std::vector<std::unique_ptr<Node>> Else, FileLocation location) :
-                    Statement(location), Condition(move(Cond)), Then(move(Then)), Else(move(Else)) {};
+        IfStatement(Expression *Cond, std::vector<Node *> Then,
+                    std::vector<Node *> Else, FileLocation location) :
+                    Statement(location), Condition(Cond), Then(move(Then)), Else(move(Else)) {};
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
     class ForLoop : public Statement {
-        std::string VariableName;
-        std::unique_ptr<Expression> Start, Condition, Step;
-        std::vector<std::unique_ptr<Node>> Body;
+        InternedString VariableName;
+        Type *VariableType;
+        Expression *Start, *Condition, *Step;
+        std::vector<Node *> Body;
+        // A number loop with integral start and step whose variable isn't assigned in the body; it counts in an i64
+        bool Counted = false;
+        // Allocations of each iteration are released at its end, see RegionScope
+        bool Region = false;
+
+        llvm::Value *codegenCondition(CompilationSession &Session, llvm::AllocaInst *Induction,
+                                      llvm::AllocaInst *Variable);
     public:
         virtual NodeType getNodeType() const { return NodeType::FOR_LOOP; }
 
-        ForLoop(std::string VariableName, std::unique_ptr<Expression> Start, std::unique_ptr<Expression> Condition,
-                std::unique_ptr<Expression> Step, std::vector<std::unique_ptr<Node>> Body, FileLocation location) :
-                    Statement(location), VariableName(VariableName), Start(std::move(Start)), Condition( std::move(Condition)),
-                    Step(std::move(Step)),Body(std::move(Body)) {};
+        ForLoop(InternedString VariableName, Type *VariableType, Expression *Start, Expression *Condition,
+                Expression *Step, std::vector<Node *> Body, FileLocation location) :
+                    Statement(location), VariableName(VariableName), VariableType(VariableType), Start(Start),
+                    Condition(Condition), Step(Step),Body(std::move(Body)) {};
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
     class WhileLoop : public Statement {
-        std::unique_ptr<Node> Condition;
-        std::vector<std::unique_ptr<Node>> Body;
+        Node *Condition;
+        std::vector<Node *> Body;
+        bool Region = false;
     public:
         virtual NodeType getNodeType() const { return NodeType::WHILE_LOOP; }
 
-        WhileLoop(std::unique_ptr<Node> Condition, std::vector<std::unique_ptr<Node>> Body, FileLocation location) :
-        Statement(location), Condition(std::move(Condition)),Body(std::move(Body)) {};
+        WhileLoop(Node *Condition, std::vector<Node *> Body, FileLocation location) :
+        Statement(location), Condition(Condition),Body(std::move(Body)) {};
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
     class Return : public Statement {
-        std::unique_ptr<Expression> Value;
+        Expression *Value;
     public:
         virtual NodeType getNodeType() const { return NodeType::RETURN; }
 
-        Return(std::unique_ptr<Expression> expression, FileLocation location) : Statement(location), Value(std::move(expression)) {};
+        Return(Expression *expression, FileLocation location) : Statement(location), Value(expression) {};
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
     class Function : public Statement {
-        std::string Name;
-        std::vector<std::pair<std::shared_ptr<Type>, std::string>> Arguments;
-        std::vector<std::unique_ptr<Node>> Body;
+        InternedString Name;
+        std::vector<std::pair<Type *, InternedString>> Arguments;
+        std::vector<Node *> Body;
+        bool Region = false;
+        // Attributes proven while checking types
+        bool ReadNone = false;
+        bool WillReturn = false;
     public:
         virtual NodeType getNodeType() const { return NodeType::FUNCTION; }
 
-        Function(const std::string name, std::shared_ptr<Type> type, FileLocation location,
-                 std::vector<std::pair<std::shared_ptr<Type>, std::string>> arguments,
-                 std::unique_ptr<Node> body) :
-                Name(name), Statement(move(type), location), Arguments(move(arguments)) {
-            Body.push_back(std::move(body));
+        Function(InternedString name, Type *type, FileLocation location,
+                 std::vector<std::pair<Type *, InternedString>> arguments,
+                 Node *body) :
+                Statement(type, location), Name(name), Arguments(move(arguments)) {
+            Body.push_back(body);
         };
 
-        Function(const std::string name, std::shared_ptr<Type> type, FileLocation location,
-                 std::vector<std::pair<std::shared_ptr<Type>, std::string>> arguments,
-                 std::vector<std::unique_ptr<Node>> body) :
-                Name(name), Statement(move(type), location), Arguments(move(arguments)), Body(move(body)) {}
+        Function(InternedString name, Type *type, FileLocation location,
+                 std::vector<std::pair<Type *, InternedString>> arguments,
+                 std::vector<Node *> body) :
+                Statement(type, location), Name(name), Arguments(move(arguments)), Body(move(body)) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
     class Extern : public Statement {
-        std::string Name;
-        std::vector<std::pair<std::shared_ptr<Type>, std::string>> Arguments;
+        InternedString Name;
+        std::vector<std::pair<Type *, InternedString>> Arguments;
     public:
         virtual NodeType getNodeType() const { return NodeType::EXTERN; }
 
-        Extern(const std::string name, std::unique_ptr<Type> type, FileLocation location,
-               std::vector<std::pair<std::shared_ptr<Type>, std::string>> arguments) :
-                Name(name), Statement(move(type), location), Arguments(move(arguments)) {}
+        Extern(InternedString name, Type *type, FileLocation location,
+               std::vector<std::pair<Type *, InternedString>> arguments) :
+                Statement(type, location), Name(name), Arguments(move(arguments)) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
     class Assembly : public Statement {
@@ -337,24 +410,24 @@ namespace t {
         Assembly(const std::string assemblyCode, FileLocation location) :
                 Statement(location), AssemblyCode(assemblyCode) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
     class Structure : public Statement {
     public:
-        std::string Name;
-        vector<pair<string, shared_ptr<Type>>> Members;
+        InternedString Name;
+        vector<pair<InternedString, Type *>> Members;
 
         virtual NodeType getNodeType() const { return NodeType::STRUCTURE; }
 
-        Structure(string Name, vector<pair<string, shared_ptr<Type>>> members, FileLocation location) :
-                Statement(location), Members(move(members)), Name(Name) {}
+        Structure(InternedString Name, vector<pair<InternedString, Type *>> members, FileLocation location) :
+                Statement(location), Name(Name), Members(move(members)) {}
 
-        virtual llvm::Value *codegen();
+        virtual llvm::Value *codegen(CompilationSession &Session);
 
-        virtual void checkType();
+        virtual void checkType(CompilationSession &Session);
     };
 
 }
\ No newline at end of file
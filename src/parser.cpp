@@ -3,6 +3,7 @@
 //
 #include <memory>
 #include <utility>
+#include "cache.h"
 #include "lexer.h"
 #include "parser.h"
 #include "error.h"
@@ -11,71 +12,63 @@ using namespace std;
 
 namespace t {
 
-    unique_ptr<Node> CheckForNull(unique_ptr<Node> node) {
-        if (!node)
-            return nullptr;
-        return move(node);
-    }
-
-    void Parser::ParseFile(string filePath, vector<unique_ptr<Node>> &FunctionDeclarations,
-                           vector<unique_ptr<Node>> &TopLevelExpressions,
-                           vector<unique_ptr<Structure>> &Structures,
-                           set<string> &ImportedFiles) {
+    void Parser::ParseFile(string filePath) {
         lexer = make_unique<Lexer>(filePath);
-        ImportedFiles.insert(filePath);
+        Session.ImportedFiles.insert(filePath);
+        // before the lexer unescapes string literals in its buffer
+        if (Session.Cache)
+            Session.Cache->AddSource(filePath, lexer->Source);
         getNextToken();     // get first token
         while (true) {
             switch (CurrentToken.type) {
                 case TokenType::EOF_TOKEN:
                     return;
                 case TokenType::DEF_TOKEN:
-                    FunctionDeclarations.push_back(move(ParseFunction()));
+                    Session.FunctionDeclarations.push_back(ParseFunction());
                     break;
                 case TokenType::EXTERN_TOKEN:
-                    FunctionDeclarations.push_back(move(ParseExtern()));
+                    Session.FunctionDeclarations.push_back(ParseExtern());
                     break;
                 case TokenType::IMPORT_TOKEN:
-                    HandleImport(FunctionDeclarations, TopLevelExpressions, Structures, ImportedFiles);
+                    HandleImport();
                     break;
                 case TokenType::STRUCT_TOKEN:
-                    Structures.push_back(move(ParseStructure()));
+                    Session.Structures.push_back(ParseStructure());
                     break;
                 default:
-                    TopLevelExpressions.push_back(move(PrimaryParse()));
+                    Session.TopLevelExpressions.push_back(PrimaryParse());
                     break;
             }
         }
     }
 
-    void Parser::HandleImport(vector<unique_ptr<Node>> &FunctionDeclarations,
-                              vector<unique_ptr<Node>> &TopLevelExpressions,
-                              vector<unique_ptr<Structure>> &Structures,
-                              set<string> &ImportedFiles) {
+    void Parser::HandleImport() {
         getNextToken();
         if (CurrentToken.type != TokenType::STRING) {
             cerr << "Expected string after import!\n";
             return;
         }
-        string filePath = get<string>(CurrentToken.value);
+        string filePath = CurrentToken.string.str();
         if(!filesystem::path(filePath).is_absolute())
-            filePath = filesystem::canonical(lexer->location.file + "/" + filePath).string();
+            filePath = filesystem::canonical(lexer->location.file.str() + "/" + filePath).string();
         getNextToken();     // eat string
-        auto parser = make_unique<Parser>();
-        if (ImportedFiles.find(filePath) == ImportedFiles.end()) {
-            parser->ParseFile(filePath, FunctionDeclarations, TopLevelExpressions, Structures, ImportedFiles);
+        auto parser = make_unique<Parser>(Session);
+        if (Session.ImportedFiles.find(filePath) == Session.ImportedFiles.end()) {
+            parser->ParseFile(filePath);
         }
     }
 
     Token Parser::getNextToken() {
+        Session.Tokens++;
         return CurrentToken = lexer->getToken();
     }
 
-    unique_ptr<Type> Parser::ParseType() {
+    Type *Parser::ParseType() {
         if (CurrentToken.type != TokenType::TYPE) {
             LogError(lexer->location, "Expected type!");
-            exit(1);
+            StopCompilation();
         }
-        auto TypeString = get<string>(CurrentToken.value);
+        auto TypeName = CurrentToken.string;
         getNextToken();     // eat type
         int size = 1;
         if (CurrentToken == '[') {
@@ -83,25 +76,25 @@ namespace t {
             // FIXME: handle dynamic array sizes
             if (CurrentToken.type != TokenType::NUMBER) {
                 LogError(lexer->location, "Expected int!");
-                exit(1);
+                StopCompilation();
             }
-            size = (int) get<double>(CurrentToken.value);
+            size = (int) CurrentToken.number;
             getNextToken();
             if (CurrentToken != ']') {
                 LogError(lexer->location, "Expected ]!");
-                exit(1);
+                StopCompilation();
             }
             getNextToken();     // eat ']
         }
         if (CurrentToken.type == TokenType::OF_TOKEN) {
             getNextToken(); // eat of
 
-            return make_unique<Type>(TypeString, move(ParseType()), size);
+            return Types.get(TypeName, ParseType(), size);
         }
-        return make_unique<Type>(TypeString, size);
+        return Types.get(TypeName, nullptr, size);
     }
 
-    unique_ptr<Node> Parser::PrimaryParse() {
+    Node *Parser::PrimaryParse() {
         switch (CurrentToken.type) {
             case TokenType::RETURN_TOKEN:
                 return ParseReturn();
@@ -120,7 +113,7 @@ namespace t {
         }
     }
 
-    unique_ptr<Expression> Parser::ParseExpression() {
+    Expression *Parser::ParseExpression() {
         if (CurrentToken == '-')
             return ParseNegative();
         else if (CurrentToken == '(')
@@ -134,6 +127,10 @@ namespace t {
                 return ParseBool();
             case TokenType::STRING:
                 return ParseString();
+            case TokenType::CHARACTER:
+                return ParseCharacter();
+            case TokenType::TYPE:
+                return ParseCast();
             default:
                 LogError(lexer->location, "Unexpected Token");
                 getNextToken(); // eat unexpected Token
@@ -141,20 +138,20 @@ namespace t {
         }
     }
 
-    unique_ptr<Expression> Parser::ParseBinaryExpression() {
+    Expression *Parser::ParseBinaryExpression() {
         auto LHS = ParseExpression();
 
         if (!LHS) {
             return nullptr;
         }
 
-        return ParseBinaryOperatorRHS(0, move(LHS));
+        return ParseBinaryOperatorRHS(0, LHS);
     }
 
-    unique_ptr<Expression> Parser::ParseBinaryOperatorRHS(int expressionPrecedence, unique_ptr<Expression> LHS) {
+    Expression *Parser::ParseBinaryOperatorRHS(int expressionPrecedence, Expression *LHS) {
         while (true) {
-            if (!holds_alternative<string>(CurrentToken.value)) {
-                return LHS; // it's not a binary operator, because it's value is not string
+            if (CurrentToken.op == 0) {
+                return LHS; // it's not a binary operator, because it's not punctuation
             }
 
             if (CurrentToken == '[') {
@@ -170,7 +167,7 @@ namespace t {
                 }
                 getNextToken(); // eat ']'
                 auto type = LHS->type;
-                LHS = make_unique<Indexing>(move(LHS), move(Index), lexer->location);
+                LHS = Session.NodeArena.make<Indexing>(LHS, Index, lexer->location);
                 LHS->type = type;   // set type of Indexing Operation to type of  the Object being indexed
             }else if (CurrentToken == '.') {
                 getNextToken(); // eat '.'
@@ -178,12 +175,12 @@ namespace t {
                     LogError(lexer->location, "Expected identifier!");
                     return nullptr;
                 }
-                string member = get<string>(CurrentToken.value);
+                auto member = CurrentToken.string;
                 getNextToken(); // eat identifier
-                LHS = make_unique<Member>(move(LHS), member, lexer->location);
+                LHS = Session.NodeArena.make<Member>(LHS, member, lexer->location);
             }
             else {
-                string Operator = get<string>(CurrentToken.value);
+                auto Operator = CurrentToken.op;
                 int TokenPrecedence = getOperatorPrecedence(Operator);
 
                 if (TokenPrecedence < expressionPrecedence) {
@@ -197,27 +194,27 @@ namespace t {
                 if (!RHS) {
                     return nullptr;
                 }
-                if (holds_alternative<string>(CurrentToken.value)) {
-                    if (TokenPrecedence < getOperatorPrecedence(get<string>(CurrentToken.value))) {
-                        RHS = ParseBinaryOperatorRHS(TokenPrecedence + 1, move(RHS));
+                if (CurrentToken.op != 0) {
+                    if (TokenPrecedence < getOperatorPrecedence(CurrentToken.op)) {
+                        RHS = ParseBinaryOperatorRHS(TokenPrecedence + 1, RHS);
                         if (!RHS)
                             return nullptr;
                     }
                 }
                 // Merge left and right
-                LHS = make_unique<BinaryExpression>(Operator, move(LHS), move(RHS), lexer->location);
+                LHS = Session.NodeArena.make<BinaryExpression>(Operator, LHS, RHS, lexer->location);
             }
         }
     }
 
-    unique_ptr<Function> Parser::ParseFunction() {
+    Function *Parser::ParseFunction() {
         getNextToken();     // eat 'def'
 
         if (CurrentToken.type != TokenType::IDENTIFIER) {
             LogError(lexer->location, "Expected Identifier");
             return nullptr;
         }
-        string Name = get<string>(CurrentToken.value);
+        auto Name = CurrentToken.string;
 
         getNextToken(); // eat Identifier
         if (CurrentToken != '(') {
@@ -234,7 +231,7 @@ namespace t {
         getNextToken();     // eat '->'
         auto Type = ParseType();
 
-        vector<unique_ptr<Node>> Body;
+        vector<Node *> Body;
 
         while (CurrentToken.type != TokenType::END_TOKEN) {
             auto Expression = PrimaryParse();
@@ -242,22 +239,22 @@ namespace t {
             if (!Expression)     // error parsing expression, return
                 return nullptr;
 
-            Body.push_back(move(Expression));
+            Body.push_back(Expression);
         }
         getNextToken();     //eat "end"
-        return make_unique<Function>(Name, move(Type), lexer->location,
-                                          move(Arguments),
-                                          move(Body));
+        return Session.NodeArena.make<Function>(Name, Type, lexer->location,
+                                                move(Arguments),
+                                                move(Body));
     }
 
-    unique_ptr<Extern> Parser::ParseExtern() {
+    Extern *Parser::ParseExtern() {
         getNextToken(); // eat 'extern'
 
         if (CurrentToken.type != TokenType::IDENTIFIER) {
             LogError(lexer->location, "Expected Identifier");
             return nullptr;
         }
-        string Name = get<string>(CurrentToken.value);
+        auto Name = CurrentToken.string;
         getNextToken(); // eat Identifier
         if (CurrentToken != '(') {
             LogError(lexer->location, "expected Parentheses");
@@ -272,10 +269,10 @@ namespace t {
         getNextToken();     // eat '->'
 
         auto Type = ParseType();
-        return make_unique<Extern>(Name, move(Type), lexer->location, move(Arguments));
+        return Session.NodeArena.make<Extern>(Name, Type, lexer->location, move(Arguments));
     }
 
-    unique_ptr<IfStatement> Parser::ParseIfStatement() {
+    IfStatement *Parser::ParseIfStatement() {
         getNextToken();     // eat 'if'
 
         auto Condition = ParseBinaryExpression();
@@ -287,7 +284,7 @@ namespace t {
             return nullptr;
         }
         getNextToken();     // eat 'then'
-        vector<unique_ptr<Node>> Then, Else;
+        vector<Node *> Then, Else;
         while (CurrentToken.type != TokenType::END_TOKEN &&
                CurrentToken.type != TokenType::ELSE_TOKEN) {
             auto Expression = PrimaryParse();
@@ -295,7 +292,7 @@ namespace t {
             if (!Expression)
                 return nullptr;
 
-            Then.push_back(move(Expression));
+            Then.push_back(Expression);
         }
         if (CurrentToken.type == TokenType::ELSE_TOKEN) {
             getNextToken();     //eat 'else'
@@ -305,23 +302,27 @@ namespace t {
                 if (!Expression)
                     return nullptr;
 
-                Else.push_back(move(Expression));
+                Else.push_back(Expression);
             }
         }
         getNextToken(); //eat 'end'
-        return make_unique<IfStatement>(move(Condition), move(Then), move(Else), lexer->location);
+        return Session.NodeArena.make<IfStatement>(Condition, move(Then), move(Else), lexer->location);
     }
 
-    unique_ptr<ForLoop> Parser::ParseForLoop() {
+    ForLoop *Parser::ParseForLoop() {
         getNextToken(); // eat "for"
 
+        auto VariableType = Types.Number;
+        if (CurrentToken.type == TokenType::TYPE)
+            VariableType = ParseType();
+
         if (CurrentToken.type != TokenType::IDENTIFIER) {
             LogError(lexer->location, "Expected identifier after 'for'!");
             return nullptr;
         }
-        string VariableName = get<string>(CurrentToken.value);
+        auto VariableName = CurrentToken.string;
         getNextToken(); // eat Identifier
-        unique_ptr<Expression> StartValue;
+        Expression *StartValue = nullptr;
         if (CurrentToken == '=') {
             getNextToken();     // eat '='
             StartValue = ParseBinaryExpression();
@@ -338,7 +339,7 @@ namespace t {
         if (!Condition)
             return nullptr;
 
-        unique_ptr<Expression> Step;
+        Expression *Step = nullptr;
         if (CurrentToken == ',') {
             getNextToken();     // eat ','
             Step = ParseBinaryExpression();
@@ -350,21 +351,21 @@ namespace t {
             return nullptr;
         }
         getNextToken();     // eat 'do'
-        vector<unique_ptr<Node>> Body;
+        vector<Node *> Body;
         while (CurrentToken.type != TokenType::END_TOKEN) {
             auto Expression = PrimaryParse();
 
             if (!Expression)
                 return nullptr;
 
-            Body.push_back(move(Expression));
+            Body.push_back(Expression);
         }
         getNextToken();     // eat 'end'
-        return make_unique<ForLoop>(VariableName, move(StartValue), move(Condition), move(Step),
-                                         move(Body), lexer->location);
+        return Session.NodeArena.make<ForLoop>(VariableName, VariableType, StartValue, Condition, Step,
+                                               move(Body), lexer->location);
     }
 
-    unique_ptr<WhileLoop> Parser::ParseWhileLoop() {
+    WhileLoop *Parser::ParseWhileLoop() {
         getNextToken();     // eat 'while'
 
         auto Condition = ParseBinaryExpression();
@@ -376,18 +377,18 @@ namespace t {
             return nullptr;
         }
         getNextToken();     // eat 'then'
-        vector<unique_ptr<Node>> Body;
+        vector<Node *> Body;
         while (CurrentToken.type != TokenType::END_TOKEN) {
             auto Expression = PrimaryParse();
             if (!Expression)
                 return nullptr;
-            Body.push_back(move(Expression));
+            Body.push_back(Expression);
         }
         getNextToken(); // eat 'end'
-        return make_unique<WhileLoop>(move(Condition), move(Body), lexer->location);
+        return Session.NodeArena.make<WhileLoop>(Condition, move(Body), lexer->location);
     }
 
-    unique_ptr<VariableDefinition> Parser::ParseVariableDefinition() {
+    VariableDefinition *Parser::ParseVariableDefinition() {
         getNextToken(); //eat "var"
 
         auto Type = ParseType();
@@ -397,11 +398,11 @@ namespace t {
             return nullptr;
         }
 
-        auto Name = get<string>(CurrentToken.value);
+        auto Name = CurrentToken.string;
         getNextToken();     // eat identifier
 
         if (CurrentToken != '=') {
-            return make_unique<VariableDefinition>(Name, move(Type));
+            return Session.NodeArena.make<VariableDefinition>(Name, Type);
         }
 
         getNextToken();     // eat '='
@@ -410,43 +411,49 @@ namespace t {
         if (!Init)
             return nullptr;     //error already logged
 
-        return make_unique<VariableDefinition>(Name, move(Init), move(Type), lexer->location);
+        return Session.NodeArena.make<VariableDefinition>(Name, Init, Type, lexer->location);
     }
 
-    unique_ptr<Negative> Parser::ParseNegative() {
+    Negative *Parser::ParseNegative() {
         getNextToken(); //eat '-'
         auto Expression = ParseBinaryExpression();
         if (!Expression)
             return nullptr;
-        return make_unique<Negative>(move(Expression), lexer->location);
+        return Session.NodeArena.make<Negative>(Expression, lexer->location);
     }
 
-    unique_ptr<Number> Parser::ParseNumber() {
-        auto number = make_unique<Number>(get<double>(CurrentToken.value), lexer->location);
+    Number *Parser::ParseNumber() {
+        auto number = Session.NodeArena.make<Number>(CurrentToken.number, lexer->location);
         getNextToken(); // eat number
-        return move(number);
+        return number;
     }
 
-    unique_ptr<Bool> Parser::ParseBool() {
-        auto boolNode = make_unique<Bool>(get<bool>(CurrentToken.value), lexer->location);
+    Bool *Parser::ParseBool() {
+        auto boolNode = Session.NodeArena.make<Bool>(CurrentToken.boolean, lexer->location);
         getNextToken(); // eat bool
-        return move(boolNode);
+        return boolNode;
     }
 
-    unique_ptr<String> Parser::ParseString() {
-        auto stringNode = make_unique<String>(get<string>(CurrentToken.value), lexer->location);
+    String *Parser::ParseString() {
+        auto stringNode = Session.NodeArena.make<String>(CurrentToken.string, lexer->location);
         getNextToken(); // eat string
-        return move(stringNode);
+        return stringNode;
     }
 
-    unique_ptr<Structure> Parser::ParseStructure() {
-        vector<pair<string, shared_ptr<Type>>> Members = {};
+    Character *Parser::ParseCharacter() {
+        auto character = Session.NodeArena.make<Character>((uint8_t) CurrentToken.number, lexer->location);
+        getNextToken(); // eat character
+        return character;
+    }
+
+    Structure *Parser::ParseStructure() {
+        vector<pair<InternedString, Type *>> Members = {};
         getNextToken(); // eat 'struct'
         if (CurrentToken.type != TokenType::IDENTIFIER) {
             LogError(lexer->location, "Expected identifier after 'struct'!");
             return nullptr;
         }
-        string Name = get<string>(CurrentToken.value);
+        auto Name = CurrentToken.string;
         getNextToken();
         while (CurrentToken.type != TokenType::END_TOKEN) {
             if (CurrentToken.type != TokenType::TYPE){
@@ -458,16 +465,16 @@ namespace t {
                 LogError(lexer->location, "Expected identifier after type!");
                 return nullptr;
             }
-            auto MemberName = get<string>(CurrentToken.value);
-            Members.push_back({MemberName, move(Type)});
+            auto MemberName = CurrentToken.string;
+            Members.push_back({MemberName, Type});
             getNextToken();
         }
         getNextToken(); // eat 'end'
         lexer->Types.insert(Name);
-        return make_unique<Structure>(Name, move(Members), lexer->location);
+        return Session.NodeArena.make<Structure>(Name, move(Members), lexer->location);
     }
 
-    unique_ptr<Expression> Parser::ParseParentheses() {
+    Expression *Parser::ParseParentheses() {
         getNextToken();
         auto value = ParseBinaryExpression();
 
@@ -480,54 +487,67 @@ namespace t {
             return nullptr;
         }
         getNextToken();
-        return move(value);
+        return value;
+    }
+
+    Cast *Parser::ParseCast() {
+        auto location = lexer->location;
+        auto type = ParseType();
+        if (CurrentToken != '(') {
+            LogError(lexer->location, "Expected '(' after type in conversion");
+            return nullptr;
+        }
+        auto value = ParseParentheses();
+        if (!value)
+            return nullptr;
+        return Session.NodeArena.make<Cast>(type, value, location);
     }
 
-    unique_ptr<Assembly> Parser::ParseAssembly(){
+    Assembly *Parser::ParseAssembly(){
         getNextToken(); // eat 'asm'
         if (CurrentToken.type != TokenType::STRING){
             LogError(lexer->location, "Expected string after 'asm'");
-            exit(1);
+            StopCompilation();
         }
-        auto assembly = make_unique<Assembly>(get<string>(CurrentToken.value), lexer->location);
+        auto assembly = Session.NodeArena.make<Assembly>(CurrentToken.string.str(), lexer->location);
         getNextToken(); // eat string
-        return move(assembly);
+        return assembly;
     }
 
-    unique_ptr<Expression> Parser::ParseIdentifier() {
-        string Name = get<string>(CurrentToken.value);
+    Expression *Parser::ParseIdentifier() {
+        auto Name = CurrentToken.string;
 
         getNextToken(); // eat identifier
 
         if (CurrentToken != '(')
             // simple variable
-            return make_unique<Variable>(Name, lexer->location);
+            return Session.NodeArena.make<Variable>(Name, lexer->location);
 
         //function call
         getNextToken(); //eat '('
-        vector<unique_ptr<Expression>> Arguments = ParseArguments();
+        vector<Expression *> Arguments = ParseArguments();
 
-        return make_unique<Call>(Name, move(Arguments), lexer->location);
+        return Session.NodeArena.make<Call>(Name, move(Arguments), lexer->location);
     }
 
-    unique_ptr<Return> Parser::ParseReturn() {
+    Return *Parser::ParseReturn() {
         getNextToken();     // eat 'return'
         auto Expression = ParseBinaryExpression();
         if (!Expression)
             return nullptr;
 
-        return make_unique<Return>(move(Expression), lexer->location);
+        return Session.NodeArena.make<Return>(Expression, lexer->location);
     }
 
-    vector<unique_ptr<Expression>> Parser::ParseArguments() {
-        vector<unique_ptr<Expression>> Arguments;
+    vector<Expression *> Parser::ParseArguments() {
+        vector<Expression *> Arguments;
         if (CurrentToken == ')') {
             getNextToken();     // eat ')', no arguments
             return Arguments;
         }
         while (CurrentToken != ')') {
             if (auto Argument = ParseBinaryExpression()) {
-                Arguments.push_back(move(Argument));
+                Arguments.push_back(Argument);
             } else {
                 LogError(lexer->location, "Invalid Arguments");
                 return {};
@@ -546,8 +566,8 @@ namespace t {
         return Arguments;
     }
 
-    vector<pair<shared_ptr<Type>, string>> Parser::ParseArgumentDefinition() {
-        vector<pair<shared_ptr<Type>, string>> Arguments;
+    vector<pair<Type *, InternedString>> Parser::ParseArgumentDefinition() {
+        vector<pair<Type *, InternedString>> Arguments;
         if (CurrentToken == ')') {
             getNextToken(); // eat ')' in case 0 of arguments.
             return Arguments;
@@ -558,8 +578,8 @@ namespace t {
                 LogError(lexer->location, "Expected identifier after type!");
                 return {};
             }
-            auto Name = get<string>(CurrentToken.value);
-            Arguments.push_back(make_pair(move(Type), Name));
+            auto Name = CurrentToken.string;
+            Arguments.push_back(make_pair(Type, Name));
             getNextToken();     // eat identifier
             if (CurrentToken == ',') {
                 getNextToken(); // eat ',' and continue
@@ -574,9 +594,27 @@ namespace t {
         return Arguments;
     }
 
-    int getOperatorPrecedence(string Operator) {
-        if (OperatorPrecedence[Operator] <= 0)
-            return -1;
-        return OperatorPrecedence[Operator];
+    int getOperatorPrecedence(Punctuator Operator) {
+        switch (Operator) {
+            case punctuator('='):
+                return 1;
+            case punctuator('<'):
+            case punctuator('>'):
+            case punctuator('<', '='):
+            case punctuator('>', '='):
+            case punctuator('=', '='):
+                return 10;
+            case punctuator('+'):
+            case punctuator('-'):
+                return 20;
+            case punctuator('/'):
+            case punctuator('*'):
+                return 30;
+            case punctuator('['):   // postfix indexing and member access bind tighter than any binary operator
+            case punctuator('.'):
+                return 40;
+            default:
+                return -1;
+        }
     }
 }
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <map>
+#include "codegen.h"
 #include "nodes.h"
 #include "lexer.h"
 
@@ -12,83 +12,73 @@ using namespace std;
 
 namespace t {
 
-    static map<string, int> OperatorPrecedence{
-            {"=",  1},
-            {"<",  10},
-            {"<=", 10},
-            {">=", 10},
-            {"==", 10},
-            {"<",  10},
-            {">",  10},
-            {"+",  20},
-            {"-",  20},
-            {"/",  30},
-            {"*",  30},
-    };
-
     class Parser {
     public:
+        // The AST and imported files go to Session
+        CompilationSession &Session;
+
         Token CurrentToken;
 
         Token getNextToken();
 
         unique_ptr<Lexer> lexer;
 
-        void ParseFile(string filePath, vector<unique_ptr<Node>> &FunctionDeclarations,
-                       vector<unique_ptr<Node>> &TopLevelExpressions,
-                       vector<unique_ptr<Structure>> &Structures,
-                       set<string> &ImportedFiles);
+        explicit Parser(CompilationSession &Session) : Session(Session) {}
+
+        void ParseFile(string filePath);
+
+        void HandleImport();
+
+        Node *PrimaryParse();
 
-        void HandleImport(vector<unique_ptr<Node>> &FunctionDeclarations,
-                          vector<unique_ptr<Node>> &TopLevelExpressions,
-                          vector<unique_ptr<Structure>> &Structures,
-                          set<string> &ImportedFiles);
+        IfStatement *ParseIfStatement();
 
-        unique_ptr<Node> PrimaryParse();
+        ForLoop *ParseForLoop();
 
-        unique_ptr<IfStatement> ParseIfStatement();
+        WhileLoop *ParseWhileLoop();
 
-        unique_ptr<ForLoop> ParseForLoop();
+        VariableDefinition *ParseVariableDefinition();
 
-        unique_ptr<WhileLoop> ParseWhileLoop();
+        Expression *ParseExpression();
 
-        unique_ptr<VariableDefinition> ParseVariableDefinition();
+        Expression *ParseBinaryExpression();
 
-        unique_ptr<Expression> ParseExpression();
+        Expression *ParseBinaryOperatorRHS(int expressionPrecedence, Expression *LHS);
 
-        unique_ptr<Expression> ParseBinaryExpression();
+        Function *ParseFunction();
 
-        unique_ptr<Expression> ParseBinaryOperatorRHS(int expressionPrecedence, unique_ptr<Expression> LHS);
+        Extern *ParseExtern();
 
-        unique_ptr<Function> ParseFunction();
+        Negative *ParseNegative();
 
-        unique_ptr<Extern> ParseExtern();
+        Number *ParseNumber();
 
-        unique_ptr<Negative> ParseNegative();
+        Bool *ParseBool();
 
-        unique_ptr<Number> ParseNumber();
+        String *ParseString();
 
-        unique_ptr<Bool> ParseBool();
+        Character *ParseCharacter();
 
-        unique_ptr<String> ParseString();
+        Expression *ParseParentheses();
 
-        unique_ptr<Expression> ParseParentheses();
+        Cast *ParseCast();
 
-        unique_ptr<Expression> ParseIdentifier();
+        Expression *ParseIdentifier();
 
-        unique_ptr<Return> ParseReturn();
+        Return *ParseReturn();
 
-        vector<unique_ptr<Expression>> ParseArguments();
+        vector<Expression *> ParseArguments();
 
-        vector<pair<shared_ptr<Type>, string>> ParseArgumentDefinition();
+        vector<pair<Type *, InternedString>> ParseArgumentDefinition();
 
-        unique_ptr<Type> ParseType();
+        Type *ParseType();
 
-        unique_ptr<Assembly> ParseAssembly();
+        Assembly *ParseAssembly();
 
-        unique_ptr<Structure> ParseStructure();
+        Structure *ParseStructure();
     };
 
-    int getOperatorPrecedence(string Operator);
+    // Returns -1 for tokens that aren't binary operators
+    int getOperatorPrecedence(Punctuator Operator);
 
 }
\ No newline at end of file
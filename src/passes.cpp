@@ -4,11 +4,14 @@
 
 #include "passes.h"
 #include "nodes.h"
+#include "codegen.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 
 PreservedAnalyses RemoveAfterFirstTerminatorPass::run(Function &F,
-                                      FunctionAnalysisManager &AM) {
+                                      FunctionAnalysisManager &) {
     SmallVector<Instruction * > ToBeErased;
     for(BasicBlock &BB : F){
         bool isTerminated = false;
@@ -26,7 +29,7 @@ PreservedAnalyses RemoveAfterFirstTerminatorPass::run(Function &F,
 }
 
 PreservedAnalyses RemoveEmptyBasicBlocksPass::run(Function &F,
-                                                              FunctionAnalysisManager &AM) {
+                                                              FunctionAnalysisManager &) {
     EliminateUnreachableBlocks(F);
     SmallVector<BasicBlock*> ToBeRemoved;
     for(auto &BB : F){
@@ -37,4 +40,133 @@ PreservedAnalyses RemoveEmptyBasicBlocksPass::run(Function &F,
         BB->eraseFromParent();
     }
     return PreservedAnalyses::all();
-}
\ No newline at end of file
+}
+
+// The list whose length Length was loaded from: the pointer the load reads, with casts and all-zero GEPs stripped.
+// Looks through phis (e.g. from GVN) as long as all loads behind them read the same list.
+static Value *getListOfLength(Value *Length) {
+    Value *List = nullptr;
+    SmallPtrSet<Value *, 8> Visited;
+    SmallVector<Value *, 8> Worklist = {Length};
+    while (!Worklist.empty()) {
+        auto *Current = Worklist.pop_back_val();
+        if (!Visited.insert(Current).second)
+            continue;
+        if (auto *Phi = dyn_cast<PHINode>(Current)) {
+            Worklist.append(Phi->value_op_begin(), Phi->value_op_end());
+            continue;
+        }
+        auto *Load = dyn_cast<LoadInst>(Current);
+        if (!Load || (List && List != Load->getPointerOperand()->stripPointerCasts()))
+            return nullptr;
+        List = Load->getPointerOperand()->stripPointerCasts();
+    }
+    return List;
+}
+
+// Whether the edge From -> To is only taken if Incoming < length of List
+static bool isEdgeGuardedByLength(BasicBlock *From, BasicBlock *To, Value *Incoming, Value *List, ScalarEvolution &SE) {
+    // walk up through blocks that just branch on, like the preheader of a loop
+    while (From) {
+        auto *Branch = dyn_cast_or_null<BranchInst>(From->getTerminator());
+        if (!Branch)
+            return false;
+        if (Branch->isConditional())
+            break;
+        To = From;
+        From = From->getSinglePredecessor();
+    }
+    if (!From)
+        return false;
+
+    auto *Branch = cast<BranchInst>(From->getTerminator());
+    auto *Compare = dyn_cast<ICmpInst>(Branch->getCondition());
+    if (!Compare || Branch->getSuccessor(0) == Branch->getSuccessor(1))
+        return false;
+    auto Predicate = Branch->getSuccessor(0) == To ? Compare->getPredicate() : Compare->getInversePredicate();
+    auto *LHS = Compare->getOperand(0), *RHS = Compare->getOperand(1);
+    if (LHS != Incoming) {
+        std::swap(LHS, RHS);
+        Predicate = CmpInst::getSwappedPredicate(Predicate);
+    }
+    if (LHS != Incoming || getListOfLength(RHS) != List)
+        return false;
+    return Predicate == CmpInst::ICMP_ULT ||
+           (Predicate == CmpInst::ICMP_SLT && SE.isKnownNonNegative(SE.getSCEV(Incoming)));
+}
+
+// Lists never shrink, so if every way into the loop header checked that its induction variable is below the list's
+// length, the variable is still in range anywhere in that iteration.
+static bool isGuardedByLoopCondition(Value *Index, Value *List, BasicBlock *Block, LoopInfo &LI, ScalarEvolution &SE) {
+    auto *Phi = dyn_cast<PHINode>(Index);
+    if (!Phi)
+        return false;
+    auto *Loop = LI.getLoopFor(Phi->getParent());
+    if (!Loop || Loop->getHeader() != Phi->getParent() || !Loop->contains(Block))
+        return false;
+    for (unsigned i = 0; i < Phi->getNumIncomingValues(); i++) {
+        if (!isEdgeGuardedByLength(Phi->getIncomingBlock(i), Phi->getParent(), Phi->getIncomingValue(i), List, SE))
+            return false;
+    }
+    return true;
+}
+
+PreservedAnalyses BoundsCheckEliminationPass::run(Function &F, FunctionAnalysisManager &AM) {
+    auto Kind = F.getContext().getMDKindID(t::BoundsCheckMetadata);
+    auto &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+    auto &LI = AM.getResult<LoopAnalysis>(F);
+
+    SmallVector<BranchInst *> Redundant;
+    for (auto &BB : F) {
+        auto *Branch = dyn_cast_or_null<BranchInst>(BB.getTerminator());
+        if (!Branch || !Branch->getMetadata(Kind) || !Branch->isConditional())
+            continue;
+        auto *Compare = dyn_cast<ICmpInst>(Branch->getCondition());
+        if (!Compare || Compare->getPredicate() != CmpInst::ICMP_ULT)
+            continue;
+        auto *Index = Compare->getOperand(0), *Length = Compare->getOperand(1);
+
+        auto *IndexSCEV = SE.getSCEV(Index), *LengthSCEV = SE.getSCEV(Length);
+        if (SE.isKnownPredicate(CmpInst::ICMP_ULT, IndexSCEV, LengthSCEV) ||
+            SE.isBasicBlockEntryGuardedByCond(&BB, CmpInst::ICMP_ULT, IndexSCEV, LengthSCEV)) {
+            Redundant.push_back(Branch);
+            continue;
+        }
+        auto *List = getListOfLength(Length);
+        if (List && isGuardedByLoopCondition(Index, List, &BB, LI, SE))
+            Redundant.push_back(Branch);
+    }
+    if (Redundant.empty())
+        return PreservedAnalyses::all();
+
+    // Leave the dead out-of-range paths to SimplifyCFG
+    for (auto *Branch : Redundant) {
+        Branch->setCondition(ConstantInt::getTrue(F.getContext()));
+        Branch->setMetadata(Kind, nullptr);
+    }
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+}
+
+t::Optimizer::Optimizer(TargetMachine *TM, const Triple &TargetTriple,
+                        TargetLibraryInfoImpl::VectorLibrary VectorLibrary) : TLII(TargetTriple), PB(TM) {
+    // Once loops are simplified SCEV can prove more bounds checks, e.g. after inlining made list lengths constant
+    PB.registerScalarOptimizerLateEPCallback([](FunctionPassManager &FPM, PassBuilder::OptimizationLevel) {
+        FPM.addPass(BoundsCheckEliminationPass());
+    });
+
+    // Registered before the default analyses, so it's the one that is used
+    TLII.addVectorizableFunctionsFromVecLib(VectorLibrary);
+    FAM.registerPass([this] { return TargetLibraryAnalysis(TLII); });
+
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+}
+
+void t::Optimizer::Optimize(llvm::Module &M, PassBuilder::OptimizationLevel Level) {
+    PB.buildPerModuleDefaultPipeline(Level).run(M, MAM);
+}
@@ -6,6 +6,8 @@
 #define T_PASSES_H
 
 #include <llvm/IR/PassManager.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Passes/PassBuilder.h>
 #include "nodes.h"
 namespace llvm {
 
@@ -17,7 +19,31 @@ class RemoveEmptyBasicBlocksPass : public PassInfoMixin<RemoveEmptyBasicBlocksPa
     public:
         PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
     };
+// Removes the bounds checks emitted for indexing (branches tagged with t::BoundsCheckMetadata) that are known to pass,
+// either from ScalarEvolution or because a loop condition already compared the index against the list's length.
+class BoundsCheckEliminationPass : public PassInfoMixin<BoundsCheckEliminationPass> {
+    public:
+        PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM);
+    };
 
 } // namespace llvm
 
+namespace t {
+    // Pass builder and analysis managers for running the passes of t and the standard pipelines, which then include
+    // BoundsCheckEliminationPass and vectorize math calls with VectorLibrary
+    struct Optimizer {
+        LoopAnalysisManager LAM;
+        FunctionAnalysisManager FAM;
+        CGSCCAnalysisManager CGAM;
+        ModuleAnalysisManager MAM;
+        TargetLibraryInfoImpl TLII;
+        PassBuilder PB;
+
+        Optimizer(TargetMachine *TM, const Triple &TargetTriple, TargetLibraryInfoImpl::VectorLibrary VectorLibrary);
+
+        // Runs the standard pipeline of Level on verified IR
+        void Optimize(llvm::Module &M, PassBuilder::OptimizationLevel Level);
+    };
+}
+
 #endif //T_PASSES_H
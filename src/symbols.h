@@ -4,85 +4,197 @@
 
 #pragma once
 
+#include <deque>
 #include "error.h"
 
 namespace t {
 
+    // Variables, functions and structures live in one open-addressing hash table keyed by interned name. Each slot
+    // points at the innermost variable binding of its name; bindings of a scope are undone when the scope is destroyed,
+    // so lookups cost the same no matter how deeply scopes are nested.
     class Symbols {
         struct Variable {
-            shared_ptr<Type> type;
+            Type *type;
             llvm::Value *address;
+            bool assigned = false;  // target of an assignment after its definition
+            size_t scope = 0;       // depth of the scope it was defined in
         };
         struct Argument {
-            shared_ptr<Type> type;
-            string name;
+            Type *type;
+            InternedString name;
         };
         struct Function {
-            shared_ptr<Type> type;
+            Type *type;
             vector<Argument> arguments;
             llvm::Function *function;
+            // proven by the type checker, see FunctionEffects
+            bool readNone = false;
+            bool willReturn = false;
         };
         struct Structure{
-            vector<pair<string, shared_ptr<Type>>> members;
+            vector<pair<InternedString, Type *>> members;
             llvm::StructType *type;
         };
 
-        vector<map<string, Variable>> Variables;
-        map<string, Function> Functions;
-        map<string, Structure> Structures;
+        static constexpr int32_t None = -1;
+
+        struct Slot {
+            InternedString name;    // empty for unused slots
+            int32_t variable = None;
+            int32_t function = None;
+            int32_t structure = None;
+        };
+        struct Binding {
+            InternedString name;
+            Variable variable;
+            int32_t shadowed;       // binding of the same name in an outer scope
+        };
+
+        vector<Slot> Table = vector<Slot>(64);
+        size_t UsedSlots = 0;
+        vector<Binding> Bindings;
+        vector<size_t> Scopes = {0};    // index of the first binding of each scope
+        deque<Function> Functions;
+        deque<Structure> Structures;
+
+        static size_t Hash(InternedString name) { return name.id() * 0x9E3779B1u; }
+
+        Slot *FindSlot(InternedString name) {
+            size_t mask = Table.size() - 1;
+            for (size_t i = Hash(name) & mask;; i = (i + 1) & mask) {
+                if (Table[i].name == name)
+                    return &Table[i];
+                if (Table[i].name.empty())
+                    return nullptr;
+            }
+        }
+
+        Slot &GetOrCreateSlot(InternedString name) {
+            if ((UsedSlots + 1) * 2 > Table.size())
+                Grow();
+            size_t mask = Table.size() - 1;
+            size_t i = Hash(name) & mask;
+            for (; !Table[i].name.empty(); i = (i + 1) & mask) {
+                if (Table[i].name == name)
+                    return Table[i];
+            }
+            UsedSlots++;
+            Table[i].name = name;
+            return Table[i];
+        }
+
+        void Grow() {
+            vector<Slot> Old(Table.size() * 2);
+            swap(Old, Table);
+            size_t mask = Table.size() - 1;
+            for (auto &slot: Old) {
+                if (slot.name.empty())
+                    continue;
+                size_t i = Hash(slot.name) & mask;
+                while (!Table[i].name.empty())
+                    i = (i + 1) & mask;
+                Table[i] = slot;
+            }
+        }
+
     public:
         void Reset() {
-            Variables = vector<map<string, Variable>>();
-            Variables.push_back(map<string, Variable>());
-            Functions = map<string, Function>();
+            Bindings.clear();
+            Scopes = {0};
+            Functions.clear();
+            for (auto &slot: Table) {
+                slot.variable = None;
+                slot.function = None;
+            }
         }
 
-        void CreateVariable(string name, shared_ptr<Type> type, llvm::Value *value = nullptr) {
-            Variables.back()[name] = {type, value};
+        void CreateVariable(InternedString name, Type *type, llvm::Value *value = nullptr) {
+            auto &slot = GetOrCreateSlot(name);
+            if (slot.variable != None && slot.variable >= (int32_t) Scopes.back()) {
+                // redefinition in the same scope
+                Bindings[slot.variable].variable = {type, value, false, Scopes.size()};
+                return;
+            }
+            Bindings.push_back({name, {type, value, false, Scopes.size()}, slot.variable});
+            slot.variable = (int32_t) Bindings.size() - 1;
         }
 
+        size_t ScopeDepth() const { return Scopes.size(); }
+
         void CreateScope() {
-            Variables.push_back(map<string, Variable>());
+            Scopes.push_back(Bindings.size());
         }
 
         void DestroyScope() {
-            Variables.pop_back();
+            while (Bindings.size() > Scopes.back()) {
+                FindSlot(Bindings.back().name)->variable = Bindings.back().shadowed;
+                Bindings.pop_back();
+            }
+            if (Scopes.size() > 1)
+                Scopes.pop_back();
         }
 
-        void CreateFunction(string name, shared_ptr<Type> returnType, vector<pair<shared_ptr<Type>, string>> arguments,
+        void CreateFunction(InternedString name, Type *returnType, const vector<pair<Type *, InternedString>> &arguments,
                             llvm::Function *function = nullptr) {
             vector<Argument> args;
             for (auto &arg: arguments)
                 args.push_back({arg.first, arg.second});
-            Functions[name] = {returnType, args, function};
+            auto &slot = GetOrCreateSlot(name);
+            if (slot.function == None) {
+                slot.function = (int32_t) Functions.size();
+                Functions.emplace_back();
+            }
+            auto &entry = Functions[slot.function];
+            entry.type = returnType;
+            entry.arguments = move(args);
+            entry.function = function;
         }
 
-        void CreateStructure(string name, vector<pair<string, shared_ptr<Type>>> members, llvm::StructType *type) {
-            Structures[name] = {members, type};
+        void SetFunctionEffects(InternedString name, bool readNone, bool willReturn) {
+            auto *slot = FindSlot(name);
+            if (slot && slot->function != None) {
+                Functions[slot->function].readNone = readNone;
+                Functions[slot->function].willReturn = willReturn;
+            }
         }
 
-        Variable GetVariable(string name) {
-            for (auto Scope: Variables) {
-                auto it = Scope.find(name);
-                if (it != Scope.end())
-                    return Scope[name];
+        void CreateStructure(InternedString name, const vector<pair<InternedString, Type *>> &members,
+                             llvm::StructType *type) {
+            auto &slot = GetOrCreateSlot(name);
+            if (slot.structure == None) {
+                slot.structure = (int32_t) Structures.size();
+                Structures.emplace_back();
             }
-            return {nullptr, nullptr};
+            Structures[slot.structure] = {members, type};
+        }
+
+        void MarkAssigned(InternedString name) {
+            auto *slot = FindSlot(name);
+            if (slot && slot->variable != None)
+                Bindings[slot->variable].variable.assigned = true;
+        }
+
+        // The Get functions return nullptr if there is no symbol with that name
+        const Variable *GetVariable(InternedString name) {
+            auto *slot = FindSlot(name);
+            if (!slot || slot->variable == None)
+                return nullptr;
+            return &Bindings[slot->variable].variable;
         }
 
-        Function GetFunction(std::string name) {
-            auto it = Functions.find(name);
-            if (it != Functions.end())
-                return Functions[name];
-            return {nullptr, {}, nullptr};
+        const Function *GetFunction(InternedString name) {
+            auto *slot = FindSlot(name);
+            if (!slot || slot->function == None)
+                return nullptr;
+            return &Functions[slot->function];
         }
 
-        Structure GetStructure(std::string name) {
-            auto it = Structures.find(name);
-            if (it != Structures.end())
-                return Structures[name];
-            return {vector<pair<string, shared_ptr<Type>>>(), nullptr};
+        const Structure *GetStructure(InternedString name) {
+            auto *slot = FindSlot(name);
+            if (!slot || slot->structure == None)
+                return nullptr;
+            return &Structures[slot->structure];
         }
 
     };
-}
\ No newline at end of file
+}
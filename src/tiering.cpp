@@ -0,0 +1,169 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#include <chrono>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Support/Format.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include "passes.h"
+#include "tiering.h"
+
+using namespace std;
+using namespace llvm;
+
+namespace t {
+
+    TieredCompiler::TieredCompiler(orc::LLJIT &JIT, orc::JITTargetMachineBuilder JTMB,
+                                   TargetLibraryInfoImpl::VectorLibrary VectorLibrary, uint64_t Threshold) :
+            JIT(JIT), JTMB(move(JTMB)), VectorLibrary(VectorLibrary), Threshold(Threshold) {
+        orc::MangleAndInterner Mangle(JIT.getExecutionSession(), JIT.getDataLayout());
+        cantFail(JIT.getMainJITDylib().define(orc::absoluteSymbols(
+                {{Mangle("t_tier_up"), JITEvaluatedSymbol(pointerToJITTargetAddress(&TierUp),
+                                                          JITSymbolFlags::Exported)}})));
+        Worker = std::thread([this] { Run(); });
+    }
+
+    void TieredCompiler::Instrument(llvm::Module &M) {
+        raw_svector_ostream Stream(Bitcode);
+        WriteBitcodeToFile(M, Stream);
+
+        auto &Context = M.getContext();
+        auto Int32 = llvm::Type::getInt32Ty(Context);
+        auto Int64 = llvm::Type::getInt64Ty(Context);
+        auto Pointer = llvm::Type::getInt8PtrTy(Context);
+        auto TierUpFunction = M.getOrInsertFunction("t_tier_up", llvm::Type::getVoidTy(Context),
+                                                    Pointer, Int32, Pointer->getPointerTo());
+        auto Self = ConstantExpr::getIntToPtr(ConstantInt::get(Int64, (uintptr_t) this), Pointer);
+        auto PointerAlign = M.getDataLayout().getPointerABIAlignment(0);
+
+        for (auto &F: M) {
+            // main runs only once
+            if (F.isDeclaration() || F.getName() == "main")
+                continue;
+            auto Id = (uint32_t) Functions.size();
+            Functions.push_back(F.getName().str());
+            F.removeFnAttr(Attribute::ReadNone);    // the counter is written
+            auto Address = new GlobalVariable(M, F.getType(), false, GlobalValue::InternalLinkage, &F,
+                                              F.getName() + ".address");
+            auto Calls = new GlobalVariable(M, Int64, false, GlobalValue::InternalLinkage, ConstantInt::get(Int64, 0),
+                                            F.getName() + ".calls");
+
+            for (auto &Use: make_early_inc_range(F.uses())) {
+                auto Call = dyn_cast<CallInst>(Use.getUser());
+                if (!Call || Call->getCalledOperand() != &F)
+                    continue;
+                // the pointer is written by the background thread
+                auto Callee = new LoadInst(F.getType(), Address, F.getName(), false, PointerAlign,
+                                           AtomicOrdering::Unordered, SyncScope::System, Call);
+                Call->setCalledOperand(Callee);
+            }
+
+            // allocas stay at the start of the entry block
+            auto &Entry = F.getEntryBlock();
+            auto Position = Entry.getFirstInsertionPt();
+            while (isa<AllocaInst>(*Position))
+                ++Position;
+            IRBuilder<> Builder(&Entry, Position);
+            auto Count = Builder.CreateAdd(Builder.CreateLoad(Int64, Calls), ConstantInt::get(Int64, 1), "calls");
+            auto Store = Builder.CreateStore(Count, Calls);
+            auto Hot = Builder.CreateICmpEQ(Count, ConstantInt::get(Int64, Threshold), "hot");
+            auto TierUpBlock = SplitBlockAndInsertIfThen(Hot, Store->getNextNode(), false,
+                                                         MDBuilder(Context).createBranchWeights(1, 1 << 20));
+            Builder.SetInsertPoint(TierUpBlock);
+            Builder.CreateCall(TierUpFunction, {Self, ConstantInt::get(Int32, Id),
+                                                Builder.CreateBitCast(Address, Pointer->getPointerTo())});
+        }
+    }
+
+    void TieredCompiler::TierUp(TieredCompiler *Compiler, uint32_t Function, void **Address) {
+        {
+            lock_guard<mutex> Lock(Compiler->Mutex);
+            Compiler->Queue.push_back({Function, Address});
+        }
+        Compiler->Wake.notify_one();
+    }
+
+    void TieredCompiler::Run() {
+        auto TM = JTMB.createTargetMachine();
+        if (!TM) {
+            consumeError(TM.takeError());
+            return;     // functions stay at tier 1
+        }
+        while (true) {
+            unique_lock<mutex> Lock(Mutex);
+            Wake.wait(Lock, [this] { return Stopping || !Queue.empty(); });
+            if (Stopping)
+                return;
+            auto Next = Queue.front();
+            Queue.pop_front();
+            Lock.unlock();
+            Compile(Next, **TM);
+        }
+    }
+
+    void TieredCompiler::Compile(Request Request, TargetMachine &TM) {
+        auto Start = chrono::steady_clock::now();
+        LLVMContext Context;
+        auto M = parseBitcodeFile(MemoryBufferRef(StringRef(Bitcode.data(), Bitcode.size()), "tier2"), Context);
+        if (!M) {
+            consumeError(M.takeError());
+            return;
+        }
+
+        // Only the hot function is visible, everything else is inlined or dropped by the optimizer
+        auto &Name = Functions[Request.Function];
+        for (auto &F: **M) {
+            if (!F.isDeclaration())
+                F.setLinkage(GlobalValue::InternalLinkage);
+        }
+        auto Hot = (*M)->getFunction(Name);
+        Hot->setName(Name + ".tier2");
+        Hot->setLinkage(GlobalValue::ExternalLinkage);
+        auto Symbol = Hot->getName().str();
+
+        Optimizer Opt(&TM, TM.getTargetTriple(), VectorLibrary);
+        Opt.Optimize(**M, PassBuilder::OptimizationLevel::O3);
+        auto Object = orc::SimpleCompiler(TM)(**M);
+        if (!Object) {
+            consumeError(Object.takeError());
+            return;
+        }
+        if (auto Err = JIT.addObjectFile(move(*Object))) {
+            consumeError(move(Err));
+            return;
+        }
+        auto Address = JIT.lookup(Symbol);
+        if (!Address) {
+            consumeError(Address.takeError());
+            return;
+        }
+        __atomic_store_n(Request.Address, (void *) Address->getAddress(), __ATOMIC_RELEASE);
+
+        chrono::duration<double, milli> Duration = chrono::steady_clock::now() - Start;
+        lock_guard<mutex> Lock(Mutex);
+        Events.push_back({Name, Duration.count()});
+    }
+
+    void TieredCompiler::Finish() {
+        {
+            lock_guard<mutex> Lock(Mutex);
+            Stopping = true;
+        }
+        Wake.notify_one();
+        if (Worker.joinable())
+            Worker.join();
+    }
+
+    void TieredCompiler::PrintStatistics(raw_ostream &Stream) {
+        lock_guard<mutex> Lock(Mutex);
+        Stream << "tiered: " << Events.size() << " of " << Functions.size() << " functions recompiled at -O3 after "
+               << Threshold << " calls\n";
+        for (auto &Event: Events)
+            Stream << "  " << Event.Function << ": " << format("%.1f", Event.Milliseconds) << " ms\n";
+    }
+}
@@ -0,0 +1,72 @@
+//
+// Created by Tommaso Peduzzi on 18.10.26.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+
+namespace t {
+
+    // Tiered compilation: the program is compiled at -O0 and each function counts its calls. Calls go through a
+    // pointer per function, which a background thread redirects to a version compiled at -O3 once the function has
+    // been called Threshold times.
+    class TieredCompiler {
+        struct Request {
+            uint32_t Function;
+            void **Address;
+        };
+        struct Event {
+            std::string Function;
+            double Milliseconds;
+        };
+
+        llvm::orc::LLJIT &JIT;
+        llvm::orc::JITTargetMachineBuilder JTMB;
+        llvm::TargetLibraryInfoImpl::VectorLibrary VectorLibrary;
+        uint64_t Threshold;
+
+        llvm::SmallVector<char, 0> Bitcode;     // the program before instrumentation, which tier 2 is compiled from
+        std::vector<std::string> Functions;     // instrumented functions by index
+
+        std::mutex Mutex;
+        std::condition_variable Wake;
+        std::deque<Request> Queue;
+        std::vector<Event> Events;
+        bool Stopping = false;
+        std::thread Worker;
+
+        static void TierUp(TieredCompiler *Compiler, uint32_t Function, void **Address);
+
+        void Run();
+
+        // Compiles the function at -O3 and points its calls at the new version
+        void Compile(Request Request, llvm::TargetMachine &TM);
+
+    public:
+        // JTMB is used for the -O3 versions
+        TieredCompiler(llvm::orc::LLJIT &JIT, llvm::orc::JITTargetMachineBuilder JTMB,
+                       llvm::TargetLibraryInfoImpl::VectorLibrary VectorLibrary, uint64_t Threshold);
+
+        ~TieredCompiler() { Finish(); }
+
+        // Keeps a copy of M to recompile functions from and adds the counters and call pointers; M must be verified
+        // and not yet compiled
+        void Instrument(llvm::Module &M);
+
+        // Stops the background thread after the compilation in progress
+        void Finish();
+
+        // Writes which functions were recompiled to Stream
+        void PrintStatistics(llvm::raw_ostream &Stream);
+    };
+}
@@ -2,7 +2,11 @@
 // Created by Tommaso Peduzzi on 06.01.22.
 //
 
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
 #include <llvm/IR/Type.h>
+#include "builtins.h"
 #include "codegen.h"
 #include "type.h"
 #include "error.h"
@@ -12,126 +16,342 @@ using namespace std;
 using namespace llvm;
 
 namespace t {
-    llvm::Type *Type::GetLLVMType() const {
-        if (type.empty()) {
+    TypeContext Types;
+
+    TypeContext::TypeContext() : ListName(InternedString::get("list")), IntName(InternedString::get("int")),
+                                 Number(get("number")), Int32(get("i32")), Int64(get("i64")), Float32(get("f32")),
+                                 Char(get("char")), Bool(get("bool")), String(get("string")), Void(get("void")) {}
+
+    Type *TypeContext::get(InternedString name, Type *subtype, int size) {
+        if (name == IntName)
+            name = Int64->name;
+        lock_guard<mutex> Lock(Mutex);
+        auto it = Interned.find({name.id(), subtype, size});
+        if (it != Interned.end())
+            return it->second;
+        auto *type = &Storage.emplace_back(Type(name, subtype, size));
+        Interned[{name.id(), subtype, size}] = type;
+        return type;
+    }
+
+    llvm::Type *Type::GetLLVMType(CompilationSession &Session) const {
+        auto &LLVMType = Session.LLVMTypes[this];
+        if (LLVMType)
+            return LLVMType;
+        if (name.empty()) {
             assert(false);
         }
-        if (type == "number")
-            return llvm::Type::getDoubleTy(*Context);
-        else if (type == "string")
-            return llvm::Type::getInt8PtrTy(*Context);
-        else if (type == "bool")
-            return llvm::Type::getInt1Ty(*Context);
-        else if (type == "void")
-            return llvm::Type::getVoidTy(*Context);
-        else if (type == "list"){
-            return llvm::StructType::get(*Context, {
-                llvm::Type::getInt32Ty(*Context),
-                llvm::PointerType::get(subtype->GetLLVMType(), 0)
-            });
-        }
+        auto &Context = *Session.Context;
+        if (name == Types.Number->name)
+            LLVMType = llvm::Type::getDoubleTy(Context);
+        else if (name == Types.Int32->name)
+            LLVMType = llvm::Type::getInt32Ty(Context);
+        else if (name == Types.Int64->name)
+            LLVMType = llvm::Type::getInt64Ty(Context);
+        else if (name == Types.Float32->name)
+            LLVMType = llvm::Type::getFloatTy(Context);
+        else if (name == Types.Char->name)
+            LLVMType = llvm::Type::getInt8Ty(Context);
+        else if (name == Types.String->name)
+            LLVMType = llvm::Type::getInt8PtrTy(Context);
+        else if (name == Types.Bool->name)
+            LLVMType = llvm::Type::getInt1Ty(Context);
+        else if (name == Types.Void->name)
+            LLVMType = llvm::Type::getVoidTy(Context);
+        else if (name == Types.ListName)
+            LLVMType = GetListHeaderType(Context)->getPointerTo();
         else{
-            auto Structure = Symbols.GetStructure(type);
-            if (Structure.members.empty() && Structure.type == nullptr) {
-                LogError("Unknown type '" + type + "'");
-                exit(1);
+            auto *Structure = Session.Symbols.GetStructure(name);
+            if (!Structure) {
+                LogError("Unknown type '" + name.str() + "'");
+                StopCompilation();
             }
-            return Structure.type;
+            // not cached until the structure has been codegenned
+            return Structure->type;
         }
+        return LLVMType;
     }
 
-    bool operator==(Type &lhs, Type &rhs) {
-        return lhs.type == rhs.type && lhs.subtype == rhs.subtype && lhs.size == rhs.size;
+    llvm::StructType *GetListHeaderType(LLVMContext &Context) {
+        if (auto *Header = llvm::StructType::getTypeByName(Context, "list"))
+            return Header;
+        auto *Int64 = llvm::Type::getInt64Ty(Context);
+        return llvm::StructType::create({Int64, Int64, llvm::Type::getInt8PtrTy(Context), Int64, Int64}, "list");
     }
 
-    bool operator!=(Type &lhs, Type &rhs) {
-        return !(rhs == lhs);
+    bool Type::isDynamicallyIndexable() const {
+        return name == Types.ListName || this == Types.String;
     }
 
-    bool operator==(shared_ptr<Type> lhs, shared_ptr<Type> rhs) {
-        if (lhs == nullptr && rhs != nullptr || rhs == nullptr && lhs != nullptr)
-            return false;
-        return *lhs == *rhs;
+    bool Type::isNegatable() const {
+        return isNumeric() || this == Types.Bool;
+    }
+
+    bool Type::isInteger() const {
+        return this == Types.Int32 || this == Types.Int64 || this == Types.Char;
+    }
+
+    bool Type::isUnsigned() const {
+        return this == Types.Char;
+    }
+
+    bool Type::isFloatingPoint() const {
+        return this == Types.Number || this == Types.Float32;
+    }
+
+    bool Type::isHeapAllocated() const {
+        return this == Types.String || name == Types.ListName;
+    }
+
+    static void NoteMemoryAccess(CompilationSession &Session) {
+        if (Session.Effects)
+            Session.Effects->AccessesMemory = true;
     }
 
-    bool operator!=(shared_ptr<Type> lhs, shared_ptr<Type> rhs) {
-        return !(rhs == lhs);
+    static void NoteMightNotReturn(CompilationSession &Session) {
+        if (Session.Effects)
+            Session.Effects->MightNotReturn = true;
+    }
+
+    static void EnterRegionScope(CompilationSession &Session, bool *Region) {
+        Session.RegionScopes.push_back({Region, Session.Symbols.ScopeDepth()});
+    }
+
+    static void LeaveRegionScope(CompilationSession &Session) {
+        auto &Scope = Session.RegionScopes.back();
+        *Scope.Region = Scope.Allocates && !Scope.Escapes;
+        Session.RegionScopes.pop_back();
+        // entering and leaving the region are runtime calls, so the function isn't readnone anymore
+        if (*Scope.Region)
+            NoteMemoryAccess(Session);
+    }
+
+    static void NoteAllocation(CompilationSession &Session) {
+        for (auto &Scope: Session.RegionScopes)
+            Scope.Allocates = true;
+    }
+
+    // A heap value is stored in a variable defined at Depth; 0 stands for anywhere
+    static void NoteEscape(CompilationSession &Session, size_t Depth = 0) {
+        for (auto &Scope: Session.RegionScopes)
+            if (Depth < Scope.Depth)
+                Scope.Escapes = true;
+    }
+
+    void Number::checkType(CompilationSession &) {
+        type = Types.Number;
+    }
+
+    bool Number::coerceTo(Type *target) {
+        auto Limit = target == Types.Int32 ? (double) INT32_MAX : (double) INT64_MAX;
+        if (target == Types.Char ? Value == trunc(Value) && Value >= 0 && Value <= UINT8_MAX
+                                 : target->isFloatingPoint() ||
+                                   (target->isInteger() && Value == trunc(Value) && fabs(Value) <= Limit)) {
+            type = target;
+            return true;
+        }
+        return false;
     }
 
-    void Number::checkType() {
-        type = make_shared<Type>("number", 1);
+    void Character::checkType(CompilationSession &) {
+        type = Types.Char;
     }
 
-    void String::checkType() {
-        type = make_shared<Type>("string", 1);
+    void String::checkType(CompilationSession &) {
+        type = Types.String;
     }
 
-    void Bool::checkType() {
-        type = make_shared<Type>("bool", 1);
+    void Bool::checkType(CompilationSession &) {
+        type = Types.Bool;
     }
 
-    void Negative::checkType() {
-        expression->checkType();
+    void Negative::checkType(CompilationSession &Session) {
+        expression->checkType(Session);
         if(!expression->type->isNegatable()){
             LogError("Negation of non-negatable type.");
-            exit(1);
+            StopCompilation();
         }
         type = expression->type;
     }
 
-    void Variable::checkType() {
-        auto variable = Symbols.GetVariable(Name);
-        if (variable.type == nullptr && variable.address == nullptr) {
-            LogError(location, "Variable " + Name + " not found!");
-            exit(1);
+    bool Negative::coerceTo(Type *target) {
+        if (!target->isNumeric() || !expression->coerceTo(target))
+            return false;
+        type = target;
+        return true;
+    }
+
+    void Variable::checkType(CompilationSession &Session) {
+        auto *variable = Session.Symbols.GetVariable(Name);
+        if (!variable) {
+            LogError(location, "Variable " + Name.str() + " not found!");
+            StopCompilation();
         }
-        type = variable.type;
+        type = variable->type;
     }
 
-    void Indexing::checkType() {
-        Index->checkType();
-        if (Index->type->type != "number") {
-            LogError(location, "Index must be a number");
-            exit(1);
+    void Indexing::checkType(CompilationSession &Session) {
+        Index->checkType(Session);
+        Index->coerceTo(Types.Int64);
+        if (!Index->type->isInteger() && Index->type != Types.Number) {
+            LogError(location, "Index must be an integer or a number");
+            StopCompilation();
         }
 
-        Object->checkType();
-        if (Object->type->subtype == nullptr)
-            type = make_shared<Type>(*(Object->type));  // in case it's a string or a statically sized array
+        Object->checkType(Session);
+        // fixed-size arrays are locals, strings and lists live in memory the function doesn't own
+        if (Object->type == Types.String || Object->type->name == Types.ListName)
+            NoteMemoryAccess(Session);
+        if (Session.CheckedIndexing)
+            NoteMemoryAccess(Session);
+        // indices out of range stop the program with --checked-indexing, and negative list indices always do
+        if (Session.CheckedIndexing || Object->type->name == Types.ListName)
+            NoteMightNotReturn(Session);
+        if (Object->type == Types.String)
+            type = Types.Char;
+        else if (Object->type->subtype == nullptr)
+            type = Types.get(Object->type->name);  // in case it's a statically sized array
         else
-            type = make_shared<Type>(*(Object->type->subtype)); // in case it's a dynamically sized list
+            type = Types.get(Object->type->subtype->name, Object->type->subtype->subtype); // in case it's a dynamically sized list
+    }
 
-        type->size = 1;
+    bool Call::checkBuiltin(CompilationSession &Session) {
+        auto *Entry = GetBuiltin(Callee);
+        if (!Entry || Session.Symbols.GetFunction(Callee))
+            return false;
+        if (Arguments.size() != Entry->Parameters.size()) {
+            LogError(location, "Wrong number of arguments for " + Callee.str());
+            StopCompilation();
+        }
+        // <float> is f32 if an argument is, number otherwise
+        Type *FloatType = Types.Number;
+        Type *ListType = nullptr;
+        for (size_t i = 0; i < Arguments.size(); i++) {
+            Arguments[i]->checkType(Session);
+            string_view Parameter = Entry->Parameters[i];
+            if (Parameter == "<float>" && Arguments[i]->type == Types.Float32)
+                FloatType = Types.Float32;
+            if (Parameter == "<list>")
+                ListType = Arguments[i]->type;
+        }
+        for (size_t i = 0; i < Arguments.size(); i++) {
+            auto *Argument = Arguments[i];
+            string_view Parameter = Entry->Parameters[i];
+            Type *Expected;
+            if (Parameter == "<list>" || Parameter == "<sequence>") {
+                if (Argument->type->name != Types.ListName && (Parameter == "<list>" || Argument->type != Types.String)) {
+                    LogError(location, Callee.str() + " takes a " + (Parameter == "<list>" ? "list" : "list or string") +
+                                       ", not " + Argument->type->str());
+                    StopCompilation();
+                }
+                continue;
+            }
+            else if (Parameter == "<element>")
+                Expected = ListType->subtype;
+            else if (Parameter == "<float>")
+                Expected = FloatType;
+            else
+                Expected = GetBuiltinType(Entry->Parameters[i]);
+            if (Argument->type != Expected && !Argument->coerceTo(Expected)) {
+                LogError(location, Callee.str() + " takes " + Expected->str() + ", not " + Argument->type->str());
+                StopCompilation();
+            }
+            // stored in a list, or the function might store new heap values in the list
+            if (Parameter == "<element>" ? Expected->isHeapAllocated() :
+                Expected->name == Types.ListName && Expected->subtype->isHeapAllocated())
+                NoteEscape(Session);
+        }
+        if (string_view(Entry->Result) == "<length>") {
+            IntegerResult = Types.Int64;
+            type = Types.Number;
+        }
+        else
+            type = string_view(Entry->Result) == "<float>" ? FloatType : GetBuiltinType(Entry->Result);
+        if (type->isHeapAllocated())
+            NoteAllocation(Session);
+        if (Entry->Memory != BuiltinMemory::None)
+            NoteMemoryAccess(Session);
+        if (!Entry->WillReturn)
+            NoteMightNotReturn(Session);
+        BuiltinFunction = Entry;
+        return true;
     }
 
-    void Call::checkType() {
-        auto function = Symbols.GetFunction(Callee);
-        if (function.type == nullptr && function.function == nullptr) {
-            LogError(location, "Function " + Callee + " not found!");
+    void Call::checkType(CompilationSession &Session) {
+        if (checkBuiltin(Session))
+            return;
+        auto *function = Session.Symbols.GetFunction(Callee);
+        if (!function) {
+            LogError(location, "Function " + Callee.str() + " not found!");
+            StopCompilation();
         }
-        auto arguments = function.arguments;
-        for (int i = 0; i < Arguments.size(); i++) {
-            Arguments[i]->checkType();
+        auto &arguments = function->arguments;
+        for (size_t i = 0; i < Arguments.size(); i++) {
+            Arguments[i]->checkType(Session);
+            if (arguments[i].type != Arguments[i]->type)
+                Arguments[i]->coerceTo(arguments[i].type);
             if (arguments[i].type != Arguments[i]->type) {
                 LogError(location, "Wrong type of argument");
-                exit(1);
+                StopCompilation();
             }
+            // the function might store new heap values in the list
+            if (arguments[i].type->name == Types.ListName && arguments[i].type->subtype->isHeapAllocated())
+                NoteEscape(Session);
+        }
+        type = function->type;
+        if (type->isHeapAllocated())
+            NoteAllocation(Session);
+        if (Session.Effects && Callee == Session.Effects->Name)
+            NoteMightNotReturn(Session);   // recursion
+        else {
+            if (!function->readNone)
+                NoteMemoryAccess(Session);
+            if (!function->willReturn)
+                NoteMightNotReturn(Session);
         }
-        type = function.type;
     }
 
-    void BinaryExpression::checkType() {
-        LHS->checkType();
-        RHS->checkType();
+    // len was a number before there were integer types. Like a number literal it still is, unless an int is expected,
+    // so both printNumber(len(text)) and i < len(list) with an int i compile.
+    bool Call::coerceTo(Type *target) {
+        if (!IntegerResult || (target != IntegerResult && target != Types.Number))
+            return false;
+        type = target;
+        return true;
+    }
 
+    void BinaryExpression::checkType(CompilationSession &Session) {
+        LHS->checkType(Session);
+        RHS->checkType(Session);
+
+        if (Op == punctuator('=') && LHS->getNodeType() == NodeType::VARIABLE)
+            Session.Symbols.MarkAssigned(((Variable *) LHS)->Name);
+        if (LHS->type != RHS->type && !RHS->coerceTo(LHS->type))
+            LHS->coerceTo(RHS->type);
         if (LHS->type != RHS->type) {
             LogError(location, "Type mismatch");
-            exit(1);
+            StopCompilation();
+        }
+        if (LHS->type == Types.String &&
+            (Op == punctuator('-') || Op == punctuator('*') || Op == punctuator('/'))) {
+            LogError(location, "Operator not supported for strings!");
+            StopCompilation();
         }
-        if(Op == "<"  || Op == ">" || Op == "<=" || Op == ">=" || Op == "=="){
-            type = make_shared<Type>("bool");
+        if (Op == punctuator('=') && LHS->type->isHeapAllocated()) {
+            if (LHS->getNodeType() == NodeType::VARIABLE)
+                NoteEscape(Session, Session.Symbols.GetVariable(((Variable *) LHS)->Name)->scope);
+            else
+                NoteEscape(Session);
         }
-        else if (Op == "+" || Op == "-" || Op == "*" || Op == "/") {
+        if (Op == punctuator('+') && LHS->type == Types.String)
+            NoteAllocation(Session);
+        if (LHS->type == Types.String)
+            NoteMemoryAccess(Session);     // string operators call the runtime
+        if(Op == punctuator('<') || Op == punctuator('>') || Op == punctuator('<', '=') ||
+           Op == punctuator('>', '=') || Op == punctuator('=', '=')){
+            type = Types.Bool;
+        }
+        else if (Op == punctuator('+') || Op == punctuator('-') || Op == punctuator('*') || Op == punctuator('/')) {
             type = LHS->type; //TODO: fix this to be dependant on the type of the operands
         }
         else{
@@ -139,125 +359,185 @@ namespace t {
         }
     }
 
-    void VariableDefinition::checkType() {
-        Symbols.CreateVariable(Name, type);
+    void VariableDefinition::checkType(CompilationSession &Session) {
+        Session.Symbols.CreateVariable(Name, type);
+        if (!Value && type->name == Types.ListName) {
+            NoteAllocation(Session);
+            NoteMemoryAccess(Session);
+        }
 
         if (Value) {
-            Value->checkType();
+            Value->checkType(Session);
+            if (Value->type != type)
+                Value->coerceTo(type);
             if (Value->type != type) {
                 LogError(location, "Value Type and Variable Type mismatch");
-                exit(1);
+                StopCompilation();
             }
         }
     }
 
-    void IfStatement::checkType() {
-        Condition->checkType();
-        if (Condition->type->type != "bool") {
+    void IfStatement::checkType(CompilationSession &Session) {
+        Condition->checkType(Session);
+        if (Condition->type != Types.Bool) {
             LogError(location, "Condition must be a boolean.");
-            exit(1);
+            StopCompilation();
         }
 
-        Symbols.CreateScope();
+        Session.Symbols.CreateScope();
         for (auto &node: Then) {
-            node->checkType();
+            node->checkType(Session);
         }
-        Symbols.DestroyScope();
-        Symbols.CreateScope();
+        Session.Symbols.DestroyScope();
+        Session.Symbols.CreateScope();
         for (auto &node: Else) {
-            node->checkType();
+            node->checkType(Session);
         }
-        Symbols.DestroyScope();
-        type = make_shared<Type>("void");
+        Session.Symbols.DestroyScope();
+        type = Types.Void;
     }
 
-    void ForLoop::checkType() {
-        Start->checkType();
-        if (Start->type != make_shared<Type>("number")) {
-            LogError(location, "Start-Value for Stepper in For-Loop must be a number");
-            exit(1);
+    void ForLoop::checkType(CompilationSession &Session) {
+        if (!VariableType->isNumeric()) {
+            LogError(location, "Stepper in For-Loop must be of a numeric type");
+            StopCompilation();
+        }
+        if (!Start) {
+            LogError(location, "Expected Start-Value for Stepper in For-Loop");
+            StopCompilation();
         }
-        Symbols.CreateScope();
-        Symbols.CreateVariable(VariableName, make_shared<Type>("number"));
+        Start->checkType(Session);
+        if (Start->type != VariableType)
+            Start->coerceTo(VariableType);
+        if (Start->type != VariableType) {
+            LogError(location, "Start-Value for Stepper in For-Loop must be a " + VariableType->str());
+            StopCompilation();
+        }
+        Session.Symbols.CreateScope();
+        Session.Symbols.CreateVariable(VariableName, VariableType);
 
-        Condition->checkType();
-        if (Condition->type->type != "bool") {
+        Condition->checkType(Session);
+        if (Condition->type != Types.Bool) {
             LogError(location, "Condition must be a boolean.");
-            exit(1);
+            StopCompilation();
         }
 
-        Step->checkType();
-        if (Step->type != make_shared<Type>("number")) {
-            LogError(location, "Step-Value for stepper must be a number");
-            exit(1);
+        if (Step) {
+            Step->checkType(Session);
+            if (Step->type != VariableType)
+                Step->coerceTo(VariableType);
+            if (Step->type != VariableType) {
+                LogError(location, "Step-Value for stepper must be a " + VariableType->str());
+                StopCompilation();
+            }
         }
-        //TODO: make start and step type changeable and check if the type of the step is compatible with the type of the start (they have to be equal)
 
+        NoteMightNotReturn(Session);
+        EnterRegionScope(Session, &Region);
         for (auto &node: Body) {
-            node->checkType();
+            node->checkType(Session);
+        }
+        LeaveRegionScope(Session);
+        if (VariableType == Types.Number && !Session.Symbols.GetVariable(VariableName)->assigned &&
+            Start->coerceTo(Types.Int64)) {
+            Counted = !Step || Step->coerceTo(Types.Int64);
+            if (!Counted)
+                Start->coerceTo(Types.Number);
         }
-        Symbols.DestroyScope();
-        type = make_shared<Type>("void");
+        Session.Symbols.DestroyScope();
+        type = Types.Void;
     }
 
-    void WhileLoop::checkType() {
-        Condition->checkType(); // TODO: check if condition is boolean
+    void WhileLoop::checkType(CompilationSession &Session) {
+        Condition->checkType(Session); // TODO: check if condition is boolean
+        NoteMightNotReturn(Session);
 
-        Symbols.CreateScope();
+        Session.Symbols.CreateScope();
+        EnterRegionScope(Session, &Region);
         for (auto &node: Body) {
-            node->checkType();
+            node->checkType(Session);
         }
-        Symbols.DestroyScope();
+        LeaveRegionScope(Session);
+        Session.Symbols.DestroyScope();
 
-        type = make_shared<Type>("void");
+        type = Types.Void;
     }
 
-    void Return::checkType() {
-        Value->checkType();
-        type = make_shared<Type>("void");
+    void Return::checkType(CompilationSession &Session) {
+        Value->checkType(Session);
+        if (Value->type != Session.ReturnType)
+            Value->coerceTo(Session.ReturnType);
+        if (Value->type->isHeapAllocated())
+            NoteEscape(Session);
+        type = Types.Void;
+    }
+
+    void Cast::checkType(CompilationSession &Session) {
+        Value->checkType(Session);
+        if (!type->isNumeric() || !Value->type->isNumeric()) {
+            LogError(location, "Can only convert between numeric types, not from " + Value->type->str() + " to " +
+                               type->str());
+            StopCompilation();
+        }
+        Value->coerceTo(type);
     }
 
-    void Function::checkType() {
-        Symbols.CreateFunction(Name, type, Arguments);
-        Symbols.CreateScope();
+    void Function::checkType(CompilationSession &Session) {
+        Session.Symbols.CreateFunction(Name, type, Arguments);
+        Session.Symbols.CreateScope();
         for (auto &arg: Arguments) {
-            Symbols.CreateVariable(arg.second, arg.first);
+            Session.Symbols.CreateVariable(arg.second, arg.first);
         }
+        auto *EnclosingReturnType = Session.ReturnType;
+        Session.ReturnType = type;
+        auto EnclosingRegionScopes = move(Session.RegionScopes);
+        Session.RegionScopes.clear();
+        auto *EnclosingEffects = Session.Effects;
+        FunctionEffects Current{Name};
+        Session.Effects = &Current;
+        EnterRegionScope(Session, &Region);
         for (auto &node: Body) {
-            node->checkType();
+            node->checkType(Session);
         }
-        Symbols.DestroyScope();
+        LeaveRegionScope(Session);
+        Session.Effects = EnclosingEffects;
+        Session.RegionScopes = move(EnclosingRegionScopes);
+        Session.ReturnType = EnclosingReturnType;
+        ReadNone = !Current.AccessesMemory;
+        WillReturn = !Current.MightNotReturn;
+        Session.Symbols.SetFunctionEffects(Name, ReadNone, WillReturn);
+        Session.Symbols.DestroyScope();
         // type = make_shared<Type>("void"); // TODO: make the type of this node irrelevant in codegenning, so we can correctly save the type of this node
     }
 
-    void Extern::checkType() {
-        Symbols.CreateFunction(Name, type, Arguments);
+    void Extern::checkType(CompilationSession &Session) {
+        Session.Symbols.CreateFunction(Name, type, Arguments);
         // type = make_shared<Type>("void"); // TODO: make the type of this node irrelevant in codegenning, so we can correctly save the type of this node
     }
 
-    void Assembly::checkType() {
-        type = make_shared<Type>("void");
+    void Assembly::checkType(CompilationSession &) {
+        type = Types.Void;
     }
 
-    void Structure::checkType() {
-        type = make_shared<Type>("void");
-        Symbols.CreateStructure(Name, Members, nullptr);
+    void Structure::checkType(CompilationSession &Session) {
+        type = Types.Void;
+        Session.Symbols.CreateStructure(Name, Members, nullptr);
     }
 
-    void Member::checkType() {
-        Object->checkType();
-        auto Structure = Symbols.GetStructure(Object->type->type);
-        if (Structure.members == vector<pair<string, shared_ptr<Type>>>() &&  Structure.type == nullptr) {
+    void Member::checkType(CompilationSession &Session) {
+        Object->checkType(Session);
+        auto *Structure = Session.Symbols.GetStructure(Object->type->name);
+        if (!Structure) {
             LogError(location, "Object is not a structure");
-            exit(1);
+            StopCompilation();
         }
-        for (auto& Member : Structure.members){
+        for (auto& Member : Structure->members){
             if (Member.first == Name) {
-                type = move(Member.second);
+                type = Member.second;
                 return;
             }
         }
         LogError(location, "Member not found");
-        exit(1);
+        StopCompilation();
     }
 }
\ No newline at end of file
@@ -6,32 +6,105 @@
 
 #include <string>
 #include <memory>
-#include <llvm/IR/Type.h>
+#include <mutex>
+#include <deque>
+#include <unordered_map>
+#include <llvm/IR/DerivedTypes.h>
+#include "interner.h"
 
 using namespace std;
 using namespace llvm;
 
 namespace t {
 
+    class CompilationSession;
+
+    // Types are interned by TypeContext: there is exactly one Type object per distinct type, so two types are
+    // equal iff they are the same pointer.
     class Type {
-    public:
-        string type;
-        shared_ptr<Type> subtype = nullptr;
-        int size = 1;
+        friend class TypeContext;
 
-        Type() = default;
+        Type(InternedString name, Type *subtype, int size) : name(name), subtype(subtype), size(size) {}
 
-        Type(const string type, int size = 1) : type(type), size(size) {}
+    public:
+        const InternedString name;
+        Type *const subtype = nullptr;
+        const int size = 1;
 
-        Type(const string type, unique_ptr<Type> subtype, int size) : type(type), subtype(move(subtype)), size(size) {}
+        const string &str() const { return name.str(); }
 
-        llvm::Type *GetLLVMType() const;
+        // The type in the context of Session, computed on first use and cached in the session afterwards
+        llvm::Type *GetLLVMType(CompilationSession &Session) const;
 
         //TODO: Unhardcode if type can be indexed
-        bool isDynamicallyIndexable() { return type == "list" || type == "string"; }
+        bool isDynamicallyIndexable() const;
 
         //TODO: Unhardcode if type is negatable
-        bool isNegatable() { return type == "number" || type == "bool"; }
+        bool isNegatable() const;
+
+        // i32, i64 and char
+        bool isInteger() const;
+
+        // char is an unsigned byte, all other integers are signed
+        bool isUnsigned() const;
+
+        // number (double) and f32
+        bool isFloatingPoint() const;
+
+        bool isNumeric() const { return isInteger() || isFloatingPoint(); }
+
+        // strings and lists, whose values point to memory of a region
+        bool isHeapAllocated() const;
     };
 
-}
\ No newline at end of file
+    class TypeContext {
+        struct Key {
+            uint32_t name;
+            Type *subtype;
+            int size;
+
+            bool operator==(const Key &other) const {
+                return name == other.name && subtype == other.subtype && size == other.size;
+            }
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const {
+                return (hash<uint32_t>()(key.name) * 31 + hash<Type *>()(key.subtype)) * 31 + hash<int>()(key.size);
+            }
+        };
+
+        deque<Type> Storage;
+        unordered_map<Key, Type *, KeyHash> Interned;
+        mutex Mutex;    // sessions on other threads intern types too
+
+    public:
+        // Declared first: get() needs them while the builtin types below are initialized
+        const InternedString ListName;
+        // `int` is an alias of `i64`
+        const InternedString IntName;
+
+        Type *const Number;
+        Type *const Int32;
+        Type *const Int64;
+        Type *const Float32;
+        Type *const Char;
+        Type *const Bool;
+        Type *const String;
+        Type *const Void;
+
+
+        TypeContext();
+
+        // Returns the unique type with this name, subtype (for lists) and size (for fixed-size arrays)
+        Type *get(InternedString name, Type *subtype = nullptr, int size = 1);
+
+        Type *get(string_view name) { return get(InternedString::get(name)); }
+    };
+
+    extern TypeContext Types;
+
+    // Every list is a pointer to this header, which is the TList of corefn: {i64 length, i64 capacity, i8* data,
+    // i64 elementSize, i64 region}
+    llvm::StructType *GetListHeaderType(LLVMContext &Context);
+}
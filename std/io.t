@@ -1,4 +1,2 @@
-extern printString(string str) -> void
-extern printAscii(number c) -> void
-extern printNumber(number c) -> void
-extern input() -> string
\ No newline at end of file
+# printString, printAscii, printNumber, printList, writeBytes, flush, input, openFile, closeFile, hasLine, readLine,
+# parseNumber and parseInt are builtins, see src/builtins.cpp
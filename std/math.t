@@ -1,11 +1,4 @@
-def sin(number x) -> number
-    var number result = 1
-    var number pi = 3.1415926535
-    for i = 0, i < 3000, 1 do
-        result = result * (1-(x/(pi*i)))*(1-(x/(pi*-i)))
-    end
-    return result
-end
+# sin, cos, tan, sqrt, exp, log, pow and fma are builtins
 
 def factorial(number n) -> number
     var number result = 1
@@ -16,12 +9,9 @@ def factorial(number n) -> number
 end
 
 def power(number a, number x) -> number
-    var number result = 1
-    for i = 0, i < x, 1 do
-        result = result * a
-    end
-    return result
+    return pow(a, x)
 end
+
 def max(number a, number b) -> number
     if a > b do
         return a
@@ -29,36 +19,6 @@ def max(number a, number b) -> number
     return b
 end
 
-def cos(number x) -> number
-    var number result = 1
-    var number pi = 3.1415926535
-    for i = 0, i < 3000, 1 do
-        result = result * (1-(x/((pi/2)*i)))*(1-(x/((pi/2)*-i)))
-    end
-    return result
-end
-
-def tan(number x) -> number
-    var number result = 1
-    var number pi = 3.1415926535
-    for i = 0, i < 3000, 1 do
-        result = result * (1-(x/((pi/2)*i)))*(1-(x/((pi/2)*-i)))
-    end
-    return result
-end
-
-def sqrt(number x) -> number
-    var number a = x/2
-    for i = 0, i < 3000, 1 do
-        a = (a + x/a)/2
-    end
-    return a
-end
-
 def root(number x, number k) -> number
-    var number a = x/k
-    for i = 0, i < 3000, 1 do
-        a = ((k-1)*a + (x/power(a,k-1)))/k
-    end
-    return a
-end
\ No newline at end of file
+    return pow(x, 1 / k)
+end
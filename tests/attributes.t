@@ -0,0 +1,33 @@
+# Attributes the type checker proves for functions
+
+# A negative index stops the program in t_list_resize, so a function indexing a list might not return
+# CHECK:      ; Function Attrs: nounwind{{$}}
+# CHECK-NEXT: define internal double @first(
+def first(list of number l) -> number
+    return l[0]
+end
+
+# Without --checked-indexing a string index is an unchecked load
+# CHECK:      ; Function Attrs: nounwind willreturn{{$}}
+# CHECK-NEXT: define internal i8 @initial(
+def initial(string text) -> char
+    return text[0]
+end
+
+# Only computes with its arguments
+# CHECK:      ; Function Attrs: nounwind readnone willreturn{{$}}
+# CHECK-NEXT: define internal double @twice(
+def twice(number x) -> number
+    return x * 2
+end
+
+# OUTPUT: 7 104 6
+var list of number l
+push(l, 7)
+printNumber(first(l))
+printAscii(32)
+printNumber(number(initial("hello")))
+printAscii(32)
+printNumber(twice(3))
+printAscii(10)
+return 0
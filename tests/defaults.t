@@ -0,0 +1,35 @@
+# Strings that were never assigned are empty, not null, wherever they live
+
+struct Person
+    string name
+    number age
+end
+
+# They all point to one empty string, and new list elements are copied from a constant holding the default element
+# CHECK:     @empty_string = private unnamed_addr constant { i64, [1 x i8] } zeroinitializer
+# CHECK-NOT: @.str = {{.*}} [1 x i8] }
+# CHECK:     @default.Person = private unnamed_addr constant %Person { i8* getelementptr {{.*}} @empty_string
+# CHECK:     call void @t_list_resize(%list* %{{.*}}, i8* bitcast (%Person* @default.Person to i8*))
+
+# OUTPUT: [] 0
+# OUTPUT-NEXT: [c] 0
+# OUTPUT-NEXT: [x] 3
+# OUTPUT-NEXT: [y]
+var Person p
+printString("[" + p.name + "] ")
+printNumber(len(p.name))
+printAscii(10)
+var list of string names
+names[2] = "c"
+printString("[" + names[0] + names[2] + "] ")
+printNumber(len(names[1]))
+printAscii(10)
+var list of Person people
+people[1].age = 3
+printString("[" + people[0].name + "x] ")
+printNumber(people[1].age)
+printAscii(10)
+var string[3] fixed
+printString("[" + fixed[2] + "y]")
+printAscii(10)
+return 0
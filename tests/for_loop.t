@@ -0,0 +1,58 @@
+# Counted for loops: a guarded loop with preheader, body, latch and exit blocks around an i64 induction variable
+
+# CHECK-LABEL: define internal double @count(
+# CHECK:       %i = alloca i64
+# CHECK:       store i64 0, i64* %i
+# CHECK:       [[GUARD:%.*]] = icmp slt i64
+# CHECK-NEXT:  br i1 [[GUARD]], label %for.preheader, label %for.exit
+# CHECK:       for.preheader:
+# CHECK-NEXT:  br label %for.body
+# CHECK:       for.body:
+# CHECK:       br label %for.latch
+# CHECK:       for.latch:
+# CHECK:       %step = add nsw i64 %{{.*}}, 1
+# CHECK:       [[CONDITION:%.*]] = icmp slt i64
+# CHECK-NEXT:  br i1 [[CONDITION]], label %for.body, label %for.exit, !llvm.loop [[LOOP:![0-9]+]]
+# CHECK:       for.exit:
+def count(number n) -> number
+    var number s = 0
+    for i = 0, i < n, 1 do
+        s = s + i
+    end
+    return s
+end
+
+# The condition is checked before the first iteration, so this loop never runs
+# CHECK-LABEL: define internal double @never(
+# CHECK:       [[GUARD:%.*]] = icmp slt i64 %{{.*}}, 3
+# CHECK-NEXT:  br i1 [[GUARD]], label %for.preheader, label %for.exit
+# CHECK:       for.latch:
+# CHECK:       br i1 %{{.*}}, label %for.body, label %for.exit, !llvm.loop !{{[0-9]+}}
+def never() -> number
+    var number s = 1
+    for i = 5, i < 3, 1 do
+        s = s + 1
+    end
+    return s
+end
+
+# A condition that doesn't compare the induction variable might never become false, so the loop doesn't get mustprogress
+# CHECK-LABEL: define internal double @unbounded(
+# CHECK:       br i1 %{{.*}}, label %for.body, label %for.exit{{$}}
+def unbounded(number x) -> number
+    for i = 0, x < 10, 1 do
+        x = x
+    end
+    return x
+end
+
+# CHECK: [[LOOP]] = distinct !{[[LOOP]], [[PROGRESS:![0-9]+]]}
+# CHECK: [[PROGRESS]] = !{!"llvm.loop.mustprogress"}
+
+# OUTPUT: 45
+# OUTPUT-NEXT: 1
+printNumber(count(10))
+printAscii(10)
+printNumber(never())
+printAscii(10)
+return 0
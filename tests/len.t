@@ -0,0 +1,38 @@
+# len is a number, like it was before there were integer types, unless an int is expected
+def total(list of number l) -> number
+    var number s = 0
+    for int i = 0, i < len(l) do
+        s = s + l[i]
+    end
+    return s
+end
+
+# A counted loop compares with the length as it is loaded, without converting it to a number and back
+# CHECK-LABEL: define internal double @count(
+# CHECK:       %length = load i64
+# CHECK-NEXT:  %condition = icmp slt i64 %{{.*}}, %length
+def count(list of number l) -> number
+    var number n = 0
+    for i = 0, i < len(l) do
+        n = n + 1
+    end
+    return n
+end
+
+# OUTPUT: 12
+# OUTPUT-NEXT: 0.5
+# OUTPUT-NEXT: 5
+# OUTPUT-NEXT: 2
+var string text = "Hello World!"
+printNumber(len(text))
+printAscii(10)
+var list of number l
+push(l, 2)
+push(l, 3)
+printNumber(len(l) / 4)
+printAscii(10)
+printNumber(total(l))
+printAscii(10)
+printNumber(count(l))
+printAscii(10)
+return 0
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Compiles every .t file in this directory with --emit-ir, which prints the IR to stderr, and matches the IR against
+# its CHECK lines with FileCheck. The program is then linked against the runtime and run, and its output is matched
+# against its OUTPUT lines. main returns a number, so the exit status of the program means nothing.
+# Usage: tests/run.sh <t executable> <FileCheck> <C++ compiler> <directory of the runtime library>
+T=$(realpath "$1")
+FILECHECK=$2
+CXX=$3
+COREFN=$(realpath "$4")
+TESTS=$(cd "$(dirname "$0")" && pwd)
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+cd "$DIR" || exit 1
+
+FAILED=0
+for TEST in "$TESTS"/*.t; do
+    NAME=$(basename "$TEST" .t)
+    if "$T" "$TEST" --emit-ir --no-cache 2> "$NAME.ll" && "$FILECHECK" "$TEST" < "$NAME.ll" &&
+            "$CXX" -no-pie output.o -L"$COREFN" -lt_corefn -o "$NAME" &&
+            { LD_LIBRARY_PATH="$COREFN" DYLD_LIBRARY_PATH="$COREFN" "./$NAME" > "$NAME.out" || true; } &&
+            "$FILECHECK" "$TEST" --check-prefix=OUTPUT < "$NAME.out"; then
+        echo "PASS: $NAME"
+    else
+        echo "FAIL: $NAME"
+        FAILED=1
+    fi
+done
+exit $FAILED